@@ -310,14 +310,11 @@ void loop() {
   /*
    * Add this to your loop() to process the event queue.
    * Note if you initialized PowerFunctionsIR with a call to init() in your setup(), but don't call update() here
-   * signals are still sampled and enqueued resulting in an out-of-memory issue after some time and of course your
-   * event handlers won't be triggered.
+   * signals are still sampled and enqueued until the queue is full (see IR_QUEUE_SIZE in BrixxSettings.h), further
+   * signals are dropped then and of course your event handlers won't be triggered.
+   * PowerFunctionsIR::get_queue_overflows() tells you how many signals were dropped this way.
    */
   PowerFunctionsIR::update();
-  /*
-   * If your board keeps hanging on IR inputs after some time this is due to a too fast loop().
-   * Add a short delay or build a non-blocking delay around the update() function to resolve this issue.
-   */
   delay(1);
 }
 
@@ -0,0 +1,122 @@
+/*
+ * Arduino.cpp - Host side stub of the Arduino core used to build the Brixx library on Linux
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ */
+#include "Arduino.h"
+#include <string.h>
+
+namespace HostHAL {
+
+unsigned long now_micros;
+void (*attached_isr[external_interrupts])(void);
+int pin_value[NUM_DIGITAL_PINS];
+unsigned long analog_writes;
+unsigned long interrupt_attaches;
+int interrupts_locked;
+uint8_t sfr[0x200] __attribute__((aligned(2)));
+
+void fire(uint8_t interrupt, unsigned long t) {
+    now_micros = t;
+    if (interrupt < external_interrupts && attached_isr[interrupt]) attached_isr[interrupt]();
+}
+
+void reset( void ) {
+    now_micros = 0;
+    memset(attached_isr, 0, sizeof(attached_isr));
+    memset(pin_value, 0, sizeof(pin_value));
+    analog_writes = 0;
+    interrupt_attaches = 0;
+    interrupts_locked = 0;
+    memset(sfr, 0, sizeof(sfr));
+}
+
+}; // end namespace
+
+unsigned long micros( void ) {
+    // Resolution of micros() on 16 MHz boards is 4 µs (timer0 prescaler 64).
+    return HostHAL::now_micros & ~3UL;
+}
+
+unsigned long millis( void ) {
+    return HostHAL::now_micros / 1000;
+}
+
+void delay(unsigned long ms) {
+    HostHAL::now_micros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+    HostHAL::now_micros += us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < NUM_DIGITAL_PINS) HostHAL::pin_value[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < NUM_DIGITAL_PINS ? HostHAL::pin_value[pin] : LOW;
+}
+
+void analogWrite(uint8_t pin, int value) {
+    // Same calls the AVR core makes, so the cost compares to direct register writes.
+    pinMode(pin, OUTPUT);
+    digitalPinToTimer(pin);
+    HostHAL::analog_writes++;
+    if (pin < NUM_DIGITAL_PINS) HostHAL::pin_value[pin] = value;
+}
+
+uint8_t digitalPinToTimer(uint8_t pin) {
+    switch (pin) {
+        case  2: return TIMER3B;
+        case  3: return TIMER3C;
+        case  4: return TIMER0B;
+        case  5: return TIMER3A;
+        case  6: return TIMER4A;
+        case  7: return TIMER4B;
+        case  8: return TIMER4C;
+        case  9: return TIMER2B;
+        case 10: return TIMER2A;
+        case 11: return TIMER1A;
+        case 12: return TIMER1B;
+        case 13: return TIMER0A;
+        case 44: return TIMER5C;
+        case 45: return TIMER5B;
+        case 46: return TIMER5A;
+        default: return NOT_ON_TIMER;
+    }
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode) {
+    (void)mode;
+    HostHAL::interrupt_attaches++;
+    if (interrupt < HostHAL::external_interrupts) HostHAL::attached_isr[interrupt] = isr;
+}
+
+void detachInterrupt(uint8_t interrupt) {
+    if (interrupt < HostHAL::external_interrupts) HostHAL::attached_isr[interrupt] = 0;
+}
+
+void noInterrupts( void ) {
+    HostHAL::interrupts_locked++;
+}
+
+void interrupts( void ) {
+    HostHAL::interrupts_locked = 0;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (size--) written += write(*buffer++);
+    return written;
+}
@@ -0,0 +1,132 @@
+/*
+ * Arduino.h - Host side stub of the Arduino core used to build the Brixx library on Linux
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ *
+ * Only the parts of the Arduino API used by the library are provided.
+ * Time doesn't pass on its own, the simulator sets micros() explicitly and calls the attached interrupt routines
+ * (see Simulator.h).
+ */
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+
+#define F_CPU 16000000L
+#define clockCyclesPerMicrosecond() ( F_CPU / 1000000L )
+
+#define LOW     0
+#define HIGH    1
+#define INPUT   0
+#define OUTPUT  1
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define NUM_DIGITAL_PINS        70
+
+typedef uint8_t byte;
+
+unsigned long micros( void );
+unsigned long millis( void );
+void delay( unsigned long ms );
+void delayMicroseconds( unsigned int us );
+
+void pinMode( uint8_t pin, uint8_t mode );
+void digitalWrite( uint8_t pin, uint8_t value );
+int digitalRead( uint8_t pin );
+void analogWrite( uint8_t pin, int value );
+
+// Timers driving the pwm pins (numbering of the AVR cores, Arduino Mega pin mapping).
+#define NOT_ON_TIMER 0
+#define TIMER0A 1
+#define TIMER0B 2
+#define TIMER1A 3
+#define TIMER1B 4
+#define TIMER1C 5
+#define TIMER2  6
+#define TIMER2A 7
+#define TIMER2B 8
+#define TIMER3A 9
+#define TIMER3B 10
+#define TIMER3C 11
+#define TIMER4A 12
+#define TIMER4B 13
+#define TIMER4C 14
+#define TIMER4D 15
+#define TIMER5A 16
+#define TIMER5B 17
+#define TIMER5C 18
+uint8_t digitalPinToTimer( uint8_t pin );
+// Ports of the host are 8 pins each in HostHAL::sfr starting at 0x180 (not the Arduino Mega's mapping).
+#define digitalPinToPort(p) ((p) / 8 + 1)
+#define digitalPinToBitMask(p) ((uint8_t)(1 << ((p) % 8)))
+#define portOutputRegister(port) ((volatile uint8_t*)&HostHAL::sfr[0x180 + (port)])
+
+// Interrupt numbers of the Arduino Mega external interrupt pins.
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : ((p) >= 18 && (p) <= 21 ? 23 - (p) : NOT_AN_INTERRUPT)))
+void attachInterrupt( uint8_t interrupt, void (*isr)(void), int mode );
+void detachInterrupt( uint8_t interrupt );
+void noInterrupts( void );
+void interrupts( void );
+
+long map( long x, long in_min, long in_max, long out_min, long out_max );
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Registers of the Arduino Mega (data memory addresses) are simulated by HostHAL::sfr.
+#define BRIXX_HOST_SFR 1
+#define _SFR_MEM8(address) (*(volatile uint8_t*)&HostHAL::sfr[address])
+#define _SFR_MEM16(address) (*(volatile uint16_t*)&HostHAL::sfr[address])
+#define SREG _SFR_MEM8(0x5F)
+#define cli() (SREG &= 0x7F)
+#define sei() (SREG |= 0x80)
+
+// There is only one address space on the host.
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+
+// Output stream base class (Serial), only the binary writes.
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write( uint8_t value ) = 0;
+    virtual size_t write( const uint8_t *buffer, size_t size );
+    // Bytes that can be written without blocking.
+    virtual int availableForWrite( void ) { return 0; }
+};
+
+// Bidirectional stream base class (Serial), only the binary reads.
+class Stream : public Print
+{
+  public:
+    virtual int available( void ) = 0;
+    virtual int read( void ) = 0;
+    virtual int peek( void ) = 0;
+};
+
+/*
+    Host side state of the stub, used by the simulator and the benchmarks.
+*/
+namespace HostHAL {
+    // Current time returned by micros() (millis() is derived from it).
+    extern unsigned long now_micros;
+    // Interrupt routines attached by attachInterrupt() (the Arduino Mega has 6 external interrupts).
+    const uint8_t external_interrupts = 6;
+    extern void (*attached_isr[external_interrupts])(void);
+    // Last value written to each pin by analogWrite() / digitalWrite().
+    extern int pin_value[NUM_DIGITAL_PINS];
+    // Number of analogWrite() and attachInterrupt() calls.
+    extern unsigned long analog_writes;
+    extern unsigned long interrupt_attaches;
+    // Simulated register memory (see _SFR_MEM8()).
+    extern uint8_t sfr[0x200] __attribute__((aligned(2)));
+    // Nesting level of noInterrupts(), > 0 while interrupts are locked.
+    extern int interrupts_locked;
+    // Run the routine attached to interrupt as the hardware would at time t.
+    void fire( uint8_t interrupt, unsigned long t );
+    // Reset all of the state above.
+    void reset( void );
+}
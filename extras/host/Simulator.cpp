@@ -0,0 +1,166 @@
+/*
+ * Simulator.cpp - Pulse train simulator for host side tests and benchmarks of the Brixx library
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ */
+#include "Simulator.h"
+#include <time.h>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Simulator {
+
+uint16_t make_frame(bool toggle, bool escape, uint8_t channel, bool address, uint8_t mode, uint8_t data) {
+    uint8_t nibble1 = toggle << 3 | escape << 2 | (channel & 0x3);
+    uint8_t nibble2 = address << 3 | (mode & 0x7);
+    uint8_t nibble3 = data & 0xF;
+    return nibble1 << 12 | nibble2 << 8 | nibble3 << 4 | (0xF ^ nibble1 ^ nibble2 ^ nibble3);
+}
+
+uint64_t ticks( void ) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return nanos();
+#endif
+}
+
+const char* ticks_unit( void ) {
+#if defined(__x86_64__) || defined(__i386__)
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+uint64_t nanos( void ) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+unsigned long play_carrier(uint8_t interrupt, void (*tick)(void), bool (*carrier)(void), bool (*busy)(void),
+    void (*between)(void))
+{
+    unsigned long start = HostHAL::now_micros;
+    unsigned long cycles = 0;
+    unsigned long marks = 0;
+    bool last = carrier();
+    while (busy()) {
+        tick();
+        cycles++;
+        bool on = carrier();
+        if (on && !last) {
+            HostHAL::fire(interrupt, start + (unsigned long long)cycles * 1000000 / 38000);
+            marks++;
+            if (between) between();
+        }
+        last = on;
+    }
+    HostHAL::now_micros = start + (unsigned long long)cycles * 1000000 / 38000;
+    return marks;
+}
+
+PulseTrain::PulseTrain(const Config &config)
+{
+    _config = config;
+    _random = config.seed ? config.seed : 1;
+    // Start with a long pause, so the first edge is never taken for a start-stop-signal.
+    _time = 100000;
+}
+
+void PulseTrain::add_frame(uint16_t raw)
+{
+    uint8_t channel = raw >> 12 & 0x3;
+    for (uint8_t i = 0; i < _config.repeats; i++) {
+        if (i > 0) {
+            // Pause between transmissions in message lengths.
+            uint8_t pause = 1;
+            if (_config.pf_pauses) pause = i < 3 ? 5 : 5 + 2 * (channel + 1);
+            add_pause(pause * (unsigned long)SIM_MESSAGE_US);
+        }
+        add_transmission(raw);
+    }
+}
+
+void PulseTrain::add_transmission(uint16_t raw)
+{
+    unsigned long start = _time;
+    // Start bit mark, 16 data bit marks and stop bit mark.
+    _edges.push_back(_time);
+    add_interval(SIM_START_STOP_US);
+    for (int8_t bit = 15; bit >= 0; bit--) add_interval(raw & 1 << bit ? SIM_HIGH_US : SIM_LOW_US);
+    _ends.push_back(_edges.size());
+    // Continue after the stop bit's space, at least the transmission must not overlap with the next one.
+    _time = start + SIM_MESSAGE_US > _time + SIM_START_STOP_US ? start + SIM_MESSAGE_US : _time + SIM_START_STOP_US;
+}
+
+void PulseTrain::add_interval(unsigned long us)
+{
+    long interval = (long)us * _config.skew_permille / 1000 + random(-_config.jitter_us, _config.jitter_us);
+    if (interval < 1) interval = 1;
+    if (_config.noise_percent && random(0, 99) < _config.noise_percent) {
+        _edges.push_back(_time + random(1, interval - 1));
+    }
+    _time += interval;
+    _edges.push_back(_time);
+}
+
+long PulseTrain::random(long min, long max)
+{
+    if (max <= min) return min;
+    // xorshift32, deterministic on every host.
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return min + (long)(_random % (uint32_t)(max - min + 1));
+}
+
+uint64_t PulseTrain::play(uint8_t interrupt, void (*between)(void), size_t batch) const
+{
+    uint64_t spent = 0;
+    size_t edge = 0;
+    for (size_t transmission = 0; transmission < _ends.size(); ) {
+        size_t last = transmission + batch < _ends.size() ? transmission + batch : _ends.size();
+        size_t end = _ends[last - 1];
+        uint64_t start = ticks();
+        for (; edge < end; edge++) HostHAL::fire(interrupt, _edges[edge]);
+        spent += ticks() - start;
+        transmission = last;
+        if (between) between();
+    }
+    return spent;
+}
+
+uint64_t play_receivers(const PulseTrain* const* trains, const uint8_t* interrupts, size_t count,
+    void (*between)(void))
+{
+    uint64_t spent = 0;
+    std::vector<size_t> next(count, 0);
+    // Edges of one transmission in time order, as train index and time.
+    std::vector<std::pair<uint8_t, unsigned long> > batch;
+    for (size_t transmission = 0; transmission < trains[0]->transmissions(); transmission++) {
+        unsigned long until = trains[0]->edge(trains[0]->end(transmission) - 1);
+        batch.clear();
+        for (;;) {
+            // Earliest pending edge up to the end of the first train's transmission.
+            size_t first = count;
+            for (size_t i = 0; i < count; i++) {
+                if (next[i] >= trains[i]->edges() || trains[i]->edge(next[i]) > until) continue;
+                if (first == count || trains[i]->edge(next[i]) < trains[first]->edge(next[first])) first = i;
+            }
+            if (first == count) break;
+            batch.push_back(std::make_pair(interrupts[first], trains[first]->edge(next[first]++)));
+        }
+        uint64_t start = ticks();
+        for (size_t i = 0; i < batch.size(); i++) HostHAL::fire(batch[i].first, batch[i].second);
+        spent += ticks() - start;
+        if (between) between();
+    }
+    return spent;
+}
+
+}; // end namespace
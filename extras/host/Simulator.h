@@ -0,0 +1,101 @@
+/*
+ * Simulator.h - Pulse train simulator for host side tests and benchmarks of the Brixx library
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ *
+ *   - Frames are converted to the falling edges an IR receiver module would produce (one per mark).
+ *   - Edges may be distorted by jitter, clock skew and additional noise edges.
+ *   - play() sets micros() to each edge's time and calls the routine attached to the interrupt.
+ */
+#pragma once
+#include "Arduino.h"
+#include <stdint.h>
+#include <vector>
+
+namespace Simulator {
+
+/*
+    Nominal intervals between falling edges (µs) and the maximum message length used for repeat pauses.
+*/
+#define SIM_LOW_US                   421
+#define SIM_HIGH_US                  711
+#define SIM_START_STOP_US           1184
+#define SIM_MESSAGE_US             16000
+
+/*
+    Config struct - distortion and repeat settings for a PulseTrain.
+*/
+struct Config {
+    // Maximum deviation (+-µs) added to each interval.
+    uint16_t jitter_us = 0;
+    // Scale factor for all intervals in 1/1000 (clock drift of remote or receiver), 1000 = exact.
+    uint16_t skew_permille = 1000;
+    // Probability (percent) for each interval to be split by an additional noise edge.
+    uint8_t noise_percent = 0;
+    // Transmissions per frame, the LEGO remotes repeat each command 5 times.
+    uint8_t repeats = 1;
+    // Use the protocol's channel dependent pauses between repeats instead of one message length.
+    bool pf_pauses = false;
+    // Seed for the pseudo random generator, same seed = same pulse train.
+    uint32_t seed = 1;
+};
+
+// Build a raw frame from its fields and add a valid checksum.
+uint16_t make_frame(bool toggle, bool escape, uint8_t channel, bool address, uint8_t mode, uint8_t data);
+// Host timer used for benchmarks (TSC cycles on x86, nanoseconds elsewhere) and its unit's name.
+uint64_t ticks( void );
+const char* ticks_unit( void );
+// Host wall clock in nanoseconds.
+uint64_t nanos( void );
+
+/*
+    Run a sender: call tick() once per carrier cycle (38 kHz) while busy(), fire interrupt at the start of each mark
+    (the receiver module's falling edge) and call between() after it (if set). Returns the number of marks.
+*/
+unsigned long play_carrier(uint8_t interrupt, void (*tick)(void), bool (*carrier)(void), bool (*busy)(void),
+    void (*between)(void) = 0);
+
+/*
+    PulseTrain class - edge times of a sequence of frames.
+*/
+class PulseTrain
+{
+  public:
+    PulseTrain( const Config &config );
+    // Append the edges of frame (including repeats) after the edges already added.
+    void add_frame( uint16_t raw );
+    // Append a pause without edges.
+    void add_pause( unsigned long us ) { _time += us; }
+    // Number of edges and transmissions added so far.
+    size_t edges( void ) const { return _edges.size(); }
+    size_t transmissions( void ) const { return _ends.size(); }
+    // Time of edge i and index behind the last edge of transmission i.
+    unsigned long edge( size_t i ) const { return _edges[i]; }
+    size_t end( size_t i ) const { return _ends[i]; }
+    /*
+        Fire all edges on interrupt and call between() after every batch transmissions (if set).
+        Returns the ticks spent in the interrupt routines only.
+    */
+    uint64_t play( uint8_t interrupt, void (*between)(void) = 0, size_t batch = 1 ) const;
+  private:
+    void add_transmission( uint16_t raw );
+    void add_interval( unsigned long us );
+    long random( long min, long max );
+    Config _config;
+    uint32_t _random;
+    unsigned long _time;
+    std::vector<unsigned long> _edges;
+    // Index behind the last edge of each transmission.
+    std::vector<size_t> _ends;
+};
+
+/*
+    Fire the edges of count trains, each on its own interrupt, in time order (several receivers seeing the same
+    transmissions) and call between() after every transmission of the first train (if set).
+    Returns the ticks spent in the interrupt routines only.
+*/
+uint64_t play_receivers( const PulseTrain* const* trains, const uint8_t* interrupts, size_t count,
+    void (*between)(void) = 0 );
+
+}; // end namespace
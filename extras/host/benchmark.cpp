@@ -0,0 +1,929 @@
+/*
+ * benchmark.cpp - Host side benchmarks for the PowerFunctionsIR decoder
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ *
+ * Reports frames decoded per second, ISR cost per edge and update() cost per event for a set of pulse train
+ * scenarios, to be compared before and after decoder changes.
+ * Costs are host ticks (see Simulator::ticks()), use them to compare builds on the same machine only.
+ */
+#include "Arduino.h"
+#include "Simulator.h"
+#include "PowerFunctionsIR.h"
+#include "PowerFunctionsIRSender.h"
+#include "PowerFunctionsOutput.h"
+#include "PowerFunctionsOutputT.h"
+#include "OutputBank.h"
+#include "PowerFunctionsRamp.h"
+#include "SoftPWM.h"
+#include <stdio.h>
+#include <string.h>
+#if IR_SNAPSHOTS
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+using namespace PowerFunctionsIR;
+
+// Number of frames per scenario.
+#define BENCH_FRAMES 20000
+
+// Samples taken from the queue by drain() and events seen by the counting handler.
+static unsigned long decoded;
+static unsigned long handled;
+// Decoded samples equal to the frame sent (noise and jitter can turn a transmission into another 16 bit frame),
+// drain() is called after each transmission, repeats transmissions per frame.
+static unsigned long correct;
+static unsigned long transmission;
+static uint8_t repeats = 1;
+static uint8_t interrupt_number;
+// Ticks spent decoding recorded edges outside the ISR (IR_DEFERRED_DECODE only).
+static uint64_t deferred_spent;
+// Wrong results of all scenarios, main() fails if there are any.
+static unsigned long failures;
+
+// Frame number i of a sequence of frames that are never redundant to each other.
+static uint16_t frame(unsigned long i) {
+    if (i % 3 == 2) return Simulator::make_frame(i & 1, false, i >> 1 & 0x3, false, 0x4 | (i & 1), 0x4 | (i >> 3 & 1));
+    return Simulator::make_frame(i & 1, false, i >> 1 & 0x3, false, 0x1, i >> 3 & 0xF);
+}
+
+// Frame number i of a sequence of frames that are never redundant to each other, on the channels and in the modes
+// update() handles (standard rc, or single output pwm without IR_STANDARD_RC).
+static uint16_t handled_frame(unsigned long i) {
+    uint8_t channel = i % NUMBER_CHANNELS;
+    unsigned long n = i / NUMBER_CHANNELS;
+    return Simulator::make_frame(n & 1, false, channel & 0x3, channel >> 2, IR_STANDARD_RC ? 0x1 : 0x4, n & 0xF);
+}
+
+static void drain( void ) {
+#if IR_DEFERRED_DECODE
+    uint64_t start = Simulator::ticks();
+    decode_edges();
+    deferred_spent += Simulator::ticks() - start;
+#endif
+    uint16_t expected = frame(transmission++ / repeats);
+    IRSample sample;
+    while (dequeue(sample)) {
+        decoded++;
+        if (sample.raw == expected) correct++;
+    }
+}
+
+static void count_handler(IRSample &ir, ChannelState &ch) {
+    (void)ir;
+    (void)ch;
+    handled++;
+}
+
+static void reset( void ) {
+    HostHAL::reset();
+    init();
+    drain();
+    interrupt_number = digitalPinToInterrupt(IR_SAMPLE_INTERRUPT_PIN);
+    decoded = 0;
+    correct = 0;
+    transmission = 0;
+    handled = 0;
+    deferred_spent = 0;
+}
+
+static void decode_scenario(const char* name, const Simulator::Config &config) {
+    reset();
+    repeats = config.repeats;
+    Simulator::PulseTrain train(config);
+    for (unsigned long i = 0; i < BENCH_FRAMES; i++) train.add_frame(frame(i));
+    uint64_t wall = Simulator::nanos();
+    uint64_t spent = train.play(interrupt_number, drain);
+    wall = Simulator::nanos() - wall;
+    double per_edge = (double)spent / train.edges();
+    double valid = 100.0 * correct / train.transmissions();
+    printf("%-28s %9lu/%-9lu %6.1f%% %10.1f %s/edge %12.0f frames/s", name, decoded,
+        (unsigned long)train.transmissions(), valid, per_edge, Simulator::ticks_unit(), decoded * 1e9 / wall);
+#if IR_DEFERRED_DECODE
+    printf(" %8.1f %s/edge in update() %u edge overflows", (double)deferred_spent / train.edges(),
+        Simulator::ticks_unit(), get_edge_overflows());
+#endif
+#if IR_PREFILTER
+    PrefilterDrops drops = get_prefilter_drops();
+    printf(" dropped: %u checksum %u repeated", drops.checksum, drops.repeated);
+#endif
+#if IR_STATS
+    Stats stats = get_stats();
+    printf(" stats: %u start-stops %u restarts %u timing errors %u frames, queue high water %u", stats.start_stops,
+        stats.restarts, stats.timing_errors, stats.frames, stats.queue_high_water);
+#endif
+#if IR_ADAPTIVE_TIMING
+    BitTiming timing = get_bit_timing();
+    printf(" timing: %u/%u/%u us, thresholds %u/%u/%u/%u us", timing.low, timing.high, timing.start_stop,
+        timing.low_min, timing.high_min, timing.start_stop_min, timing.start_stop_max);
+#endif
+    printf("\n");
+}
+
+#if NUMBER_RECEIVERS > 1
+// All receivers see the same frames, each with its own noise edges.
+static void receivers_scenario(uint8_t noise) {
+    static const uint8_t pins[NUMBER_RECEIVERS] = { IR_RECEIVER_PINS };
+    reset();
+    repeats = 1;
+    Simulator::Config config;
+    config.noise_percent = noise;
+    Simulator::PulseTrain* trains[NUMBER_RECEIVERS];
+    uint8_t interrupts[NUMBER_RECEIVERS];
+    for (uint8_t r = 0; r < NUMBER_RECEIVERS; r++) {
+        config.seed = r + 1;
+        trains[r] = new Simulator::PulseTrain(config);
+        for (unsigned long i = 0; i < BENCH_FRAMES; i++) trains[r]->add_frame(frame(i));
+        interrupts[r] = digitalPinToInterrupt(pins[r]);
+    }
+    uint64_t spent = Simulator::play_receivers(trains, interrupts, NUMBER_RECEIVERS, drain);
+    size_t edges = 0;
+    for (uint8_t r = 0; r < NUMBER_RECEIVERS; r++) edges += trains[r]->edges();
+    char name[32];
+    snprintf(name, sizeof(name), "%u receivers noise %u%%", NUMBER_RECEIVERS, noise);
+    printf("%-28s %9lu/%-9lu %6.1f%% %10.1f %s/edge", name, decoded, (unsigned long)trains[0]->transmissions(),
+        100.0 * correct / trains[0]->transmissions(), (double)spent / edges, Simulator::ticks_unit());
+    for (uint8_t r = 0; r < NUMBER_RECEIVERS; r++) {
+        ReceiverStats stats = get_receiver_stats(r);
+        printf(" rx%u: %u frames %u merged %u errors", r, stats.frames, stats.merged, stats.errors);
+        delete trains[r];
+    }
+    printf("\n");
+}
+#endif
+
+#if IR_PWM_RC && NUMBER_CHANNELS >= 2
+// Red changed handler calls of the burst scenario.
+static unsigned long changed;
+
+static void count_changed(IRSample &ir, ChannelState &ch) {
+    (void)ir;
+    (void)ch;
+    changed++;
+}
+
+/*
+    Bursts of pwm rc increments and decrements on two channels, as queued while loop() was busy. Every burst moves red
+    of both channels by 3 - 1 steps, up and down alternately, and update() is called once per burst.
+*/
+static void burst_scenario( void ) {
+    reset();
+    generic_handler = count_handler;
+    red_changed_handler[0] = red_changed_handler[1] = count_changed;
+    // init() keeps the channel states, reset red of both channels first (pwm rc reset, then toggle bit 0).
+    for (uint8_t channel = 0; channel < 2; channel++) {
+        IRSample sample;
+        sample.raw = Simulator::make_frame(true, false, channel, false, 0x4, 0x8);
+        enqueue(sample);
+    }
+    update();
+    handled = 0;
+    changed = 0;
+    bool toggle[2] = { false, false };
+    unsigned long bursts = 0, wrong = 0, events = 0;
+    uint64_t spent = 0;
+    for (; events < BENCH_FRAMES; bursts++) {
+        bool up = !(bursts & 1);
+        for (uint8_t k = 0; k < 8; k++, events++) {
+            uint8_t channel = k & 1;
+            bool increment = (k >> 1 < 3) == up;
+            IRSample sample;
+            sample.raw = Simulator::make_frame(toggle[channel], false, channel, false, 0x6, increment ? 0x4 : 0x5);
+            toggle[channel] = !toggle[channel];
+            enqueue(sample);
+        }
+        uint64_t start = Simulator::ticks();
+        update();
+        spent += Simulator::ticks() - start;
+        int8_t expected = up ? 2 : 0;
+        for (uint8_t channel = 0; channel < 2; channel++) {
+            if (get_state_for_channel(channel).red.actual_step != expected) wrong++;
+        }
+    }
+    generic_handler = 0;
+    red_changed_handler[0] = red_changed_handler[1] = 0;
+    failures += wrong;
+    printf("%-28s %9lu events %10.1f %s/burst %.1f generic / %.1f red changed calls per burst, %lu wrong states\n",
+        "update() bursts", events, (double)spent / bursts, Simulator::ticks_unit(), (double)handled / bursts,
+        (double)changed / bursts, wrong);
+}
+#endif
+
+// Frames queued in the budget scenario, frame expected next by its handler (per channel with IR_COALESCE) and frames
+// handled out of order.
+static unsigned long budget_queued;
+#if IR_COALESCE
+static unsigned long budget_next[NUMBER_CHANNELS];
+#else
+static unsigned long budget_next;
+#endif
+static unsigned long budget_misordered;
+
+// Takes 300 µs and checks that events arrive in the order they were queued.
+static void slow_handler(IRSample &ir, ChannelState &ch) {
+    (void)ch;
+#if IR_COALESCE
+    // Coalesced, the channel's last frame applied, a later one than at its previous call.
+    uint8_t channel = ir.get_channel();
+    unsigned long i = budget_next[channel];
+    while (i < budget_queued && ir.raw != handled_frame(i)) i += NUMBER_CHANNELS;
+    if (i < budget_queued) budget_next[channel] = i + NUMBER_CHANNELS;
+    else budget_misordered++;
+#else
+    if (ir.raw != handled_frame(budget_next++)) budget_misordered++;
+#endif
+    HostHAL::now_micros += 300;
+}
+
+/*
+    update(budget_us) with handlers taking 300 µs: 6 frames arrive per loop() iteration, update(1000) works off 4 of
+    them per call, the rest stays pending until the queue is full (frames that don't fit are offered again). With
+    IR_COALESCE the handlers are called once per channel and call with its last frame applied, out of order are the
+    older frames then, lost the channels whose last frame never reached the handler.
+*/
+static void budget_scenario( void ) {
+    reset();
+    generic_handler = slow_handler;
+#if IR_COALESCE
+    for (uint8_t channel = 0; channel < NUMBER_CHANNELS; channel++) budget_next[channel] = channel;
+#else
+    budget_next = 0;
+#endif
+    budget_misordered = 0;
+    budget_queued = 0;
+    unsigned long &queued = budget_queued;
+    unsigned long calls = 0, slice_max = 0;
+    uint8_t pending = 0, pending_max = 0;
+    while (queued < BENCH_FRAMES || pending) {
+        for (uint8_t i = 0; i < 6 && queued < BENCH_FRAMES; i++) {
+            IRSample sample;
+            sample.raw = handled_frame(queued);
+            if (enqueue(sample)) queued++;
+        }
+        unsigned long start = HostHAL::now_micros;
+        pending = update(1000);
+        calls++;
+        if (HostHAL::now_micros - start > slice_max) slice_max = HostHAL::now_micros - start;
+        if (pending > pending_max) pending_max = pending;
+#if IR_COALESCE
+        // Nothing pending, the handlers must have got the last frame queued of every channel (not an older one).
+        for (uint8_t channel = 0; channel < NUMBER_CHANNELS && !pending; channel++) {
+            if (budget_next[channel] < queued) {
+                budget_misordered++;
+                budget_next[channel] = queued;
+            }
+        }
+#endif
+    }
+    generic_handler = 0;
+#if IR_COALESCE
+    unsigned long lost = 0;
+    for (uint8_t channel = 0; channel < NUMBER_CHANNELS; channel++) lost += budget_next[channel] < queued;
+#else
+    unsigned long lost = queued - budget_next;
+#endif
+    failures += budget_misordered + lost;
+    printf("%-28s %9lu events %10lu calls, longest slice %lu us, up to %u pending, %lu out of order, %lu lost\n",
+        "update(1000us)", queued, calls, slice_max, pending_max, budget_misordered, lost);
+}
+
+#if IR_FAILSAFE && IR_STANDARD_RC
+// Time the failsafe reset each subchannel, 0 while it is running.
+static unsigned long failsafe_reset[NUMBER_CHANNELS][2];
+
+static void failsafe_handler(IRSample &ir, ChannelState &ch) {
+    uint8_t channel = ir.get_channel();
+    if (ir.red_effected() && !ch.red.actual_step && !failsafe_reset[channel][0]) {
+        failsafe_reset[channel][0] = HostHAL::now_micros;
+    }
+    if (ir.blue_effected() && !ch.blue.actual_step && !failsafe_reset[channel][1]) {
+        failsafe_reset[channel][1] = HostHAL::now_micros;
+    }
+}
+
+// Frames of a held joystick and red actual_step of channel 0 after the last of them and after the next frame.
+#define HELD_FRAMES 30
+static unsigned long held_updates;
+static int8_t held_step[2];
+
+static void held_update( void ) {
+    update();
+    held_step[++held_updates != HELD_FRAMES] = get_state_for_channel(0).red.actual_step;
+}
+
+/*
+    Held joystick, decoded by the ISR (so pre-filtered with IR_PREFILTER): standard rc red forward on channel 0 every
+    100 ms for longer than the timeout must keep the subchannel, after a pause longer than the timeout the same frame
+    must set it again. Returns true if both happened.
+*/
+static bool failsafe_held_check( void ) {
+    reset();
+    held_updates = 0;
+    Simulator::PulseTrain train(Simulator::Config{});
+    uint16_t raw = Simulator::make_frame(false, false, 0, false, 0x1, 0x1);
+    for (uint8_t i = 0; i < HELD_FRAMES; i++) {
+        train.add_frame(raw);
+        train.add_pause(IR_FAILSAFE_TIMEOUT_MS * 1000UL * 3 / HELD_FRAMES);
+    }
+    train.add_pause(IR_FAILSAFE_TIMEOUT_MS * 2000UL);
+    train.add_frame(raw);
+    train.play(interrupt_number, held_update);
+    return held_step[0] && held_step[1];
+}
+
+/*
+    Signal loss: standard rc forward on all channels repeated every 100 ms for 2 s, then silence, loop() every 4 ms.
+    Counts subchannels reset too early or too late and the update() cost per loop while the timers are refreshed.
+    Pwm rc (single output mode) subchannels on channel 0 afterwards must keep their value.
+*/
+static void failsafe_scenario( void ) {
+    reset();
+    generic_handler = failsafe_handler;
+    unsigned long rounds = 0, early = 0, late = 0, loops = 0;
+    uint64_t spent = 0;
+    for (; rounds * 8 * NUMBER_CHANNELS < BENCH_FRAMES; rounds++) {
+        HostHAL::now_micros += 1000000;
+        unsigned long start = HostHAL::now_micros;
+        unsigned long last = start;
+        for (unsigned long t = 0; t < 3500000; t += 4000, loops++) {
+            HostHAL::now_micros = start + t;
+            if (t < 2000000 && t % 100000 == 0) {
+                for (uint8_t channel = 0; channel < NUMBER_CHANNELS; channel++) {
+                    IRSample sample;
+                    sample.raw = Simulator::make_frame(rounds & 1, false, channel & 0x3, channel >> 2, 0x1, 0x5);
+                    enqueue(sample);
+                }
+                last = HostHAL::now_micros;
+                memset(failsafe_reset, 0, sizeof(failsafe_reset));
+            }
+            uint64_t ticks = Simulator::ticks();
+            update();
+            spent += Simulator::ticks() - ticks;
+        }
+        for (uint8_t channel = 0; channel < NUMBER_CHANNELS; channel++) {
+            for (uint8_t sub = 0; sub < 2; sub++) {
+                unsigned long reset_after = failsafe_reset[channel][sub] - last;
+                if (!failsafe_reset[channel][sub] || reset_after > (IR_FAILSAFE_TIMEOUT_MS + 2UL * IR_FAILSAFE_TICK_MS)
+                    * 1000) {
+                    late++;
+                } else if (reset_after < IR_FAILSAFE_TIMEOUT_MS * 1000UL) {
+                    early++;
+                }
+            }
+        }
+    }
+    // Pwm rc isn't repeated by the remote, its subchannels don't time out.
+    bool pwm_kept = true;
+#if IR_PWM_RC
+    IRSample sample;
+    sample.raw = Simulator::make_frame(false, false, 0, false, 0x4, 0x4);
+    enqueue(sample);
+    update();
+    HostHAL::now_micros += 10000000;
+    update();
+    pwm_kept = get_state_for_channel(0).red.actual_step == 4;
+#endif
+    generic_handler = 0;
+    bool held_kept = failsafe_held_check();
+    failures += early + late + !pwm_kept + !held_kept;
+    printf("%-28s %9lu resets %10.1f %s/loop, %lu too early, %lu too late, pwm rc %s, held joystick %s\n", "failsafe",
+        rounds * 2 * NUMBER_CHANNELS, (double)spent / loops, Simulator::ticks_unit(), early, late,
+        pwm_kept ? "kept" : "reset", held_kept ? "kept" : "reset");
+}
+#endif
+
+#if IR_BINDINGS && IR_PWM_RC
+// Output set by the handler of the bindings scenario, the way sketches did it before bindings.
+static PowerFunctionsOutput* handler_output;
+
+static void value_handler(IRSample &ir, ChannelState &ch) {
+    (void)ir;
+    int16_t value = ch.red.value();
+    handler_output->set(value > 0 ? value : 0, value < 0 ? -value : 0);
+}
+
+// Queue a pwm rc frame for red of channel 0 (0x4 increment, 0x5 decrement, 0x8 reset) and call update().
+static void red_step(uint8_t data, bool &toggle, PowerFunctionsOutput &output, unsigned long &checked,
+    unsigned long &wrong) {
+    IRSample sample;
+    sample.raw = Simulator::make_frame(toggle, false, 0, false, data == 0x8 ? 0x4 : 0x6, data);
+    toggle = !toggle;
+    enqueue(sample);
+    update();
+    int16_t value = get_state_for_channel(0).red.value();
+    if (output.c1_get() != (value > 0 ? value : 0) || output.c2_get() != (value < 0 ? -value : 0)) wrong++;
+    checked++;
+}
+
+/*
+    Red of channel 0 bound to an output: every actual_step of steps 1-20 in both modes is compared to value(), then
+    pwm rc increments and decrements are timed with the binding and with a changed handler calling value().
+*/
+static void bindings_scenario( void ) {
+    reset();
+    PowerFunctionsOutput output(PF_OUT_A1);
+    bind(0, false, output);
+    bool toggle = false;
+    unsigned long checked = 0, wrong = 0;
+    for (uint8_t steps = 1; steps <= 20; steps++) {
+        for (uint8_t alternative = 0; alternative < 2; alternative++) {
+            set_steps(0, steps, DEFAULT_STEPS);
+            set_alternative_mode(0, alternative, false);
+            red_step(0x8, toggle, output, checked, wrong);
+            for (uint8_t i = 0; i < steps; i++) red_step(0x5, toggle, output, checked, wrong);
+            for (uint8_t i = 0; i < 2 * steps; i++) red_step(0x4, toggle, output, checked, wrong);
+        }
+    }
+    set_steps(0, DEFAULT_STEPS, DEFAULT_STEPS);
+    set_alternative_mode(0, false, false);
+    uint64_t spent[2] = { 0, 0 };
+    for (uint8_t handler = 0; handler < 2; handler++) {
+        if (handler) {
+            unbind(output);
+            handler_output = &output;
+            red_changed_handler[0] = value_handler;
+        }
+        for (unsigned long i = 0; i < BENCH_FRAMES; i++) {
+            IRSample sample;
+            sample.raw = Simulator::make_frame(toggle, false, 0, false, 0x6, i / (2 * DEFAULT_STEPS) & 1 ? 0x5 : 0x4);
+            toggle = !toggle;
+            enqueue(sample);
+            uint64_t start = Simulator::ticks();
+            update();
+            spent[handler] += Simulator::ticks() - start;
+        }
+    }
+    red_changed_handler[0] = 0;
+    failures += wrong;
+    printf("%-28s %9lu values %10.1f %s/event (handler with value() %.1f), %lu differ from value()\n", "bindings",
+        checked, (double)spent[0] / BENCH_FRAMES, Simulator::ticks_unit(), (double)spent[1] / BENCH_FRAMES, wrong);
+}
+#endif
+
+#if IR_SNAPSHOTS && IR_PWM_RC
+// Reads of the timer signal in the snapshots scenario and the ones with red != blue (half updated states).
+static volatile unsigned long snapshot_reads, snapshot_torn, snapshot_skipped, plain_torn;
+static uint16_t snapshot_seen[NUMBER_CHANNELS];
+
+static void snapshot_reader(int signal) {
+    (void)signal;
+    ChannelSnapshot snapshots[NUMBER_CHANNELS];
+    get_snapshots(snapshots);
+    for (uint8_t channel = 0; channel < NUMBER_CHANNELS; channel++) {
+        if (snapshots[channel].sequence == snapshot_seen[channel]) snapshot_skipped++;
+        snapshot_seen[channel] = snapshots[channel].sequence;
+        if (snapshots[channel].state.red.actual_step != snapshots[channel].state.blue.actual_step) snapshot_torn++;
+        ChannelState plain = get_state_for_channel(channel);
+        if (plain.red.actual_step != plain.blue.actual_step) plain_torn++;
+    }
+    snapshot_reads++;
+}
+
+/*
+    A timer signal (a control loop interrupt on the board) reads the states of all channels every 20 µs while update()
+    applies combo pwm frames setting red and blue to the same step. Counts the reads with red != blue of
+    get_snapshots() and of get_state_for_channel(), and the unchanged snapshots a reader could skip by sequence.
+*/
+static void snapshot_scenario( void ) {
+    reset();
+    // Earlier scenarios leave red != blue, set both to the same step before the first read.
+    for (uint8_t channel = 0; channel < NUMBER_CHANNELS; channel++) {
+        IRSample sample;
+        sample.raw = Simulator::make_frame(channel >> 2, true, channel & 0x3, false, 0, 0);
+        enqueue(sample);
+    }
+    update();
+    snapshot_reads = snapshot_torn = snapshot_skipped = plain_torn = 0;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = snapshot_reader;
+    sigaction(SIGALRM, &action, 0);
+    struct itimerval timer = { { 0, 20 }, { 0, 20 } };
+    setitimer(ITIMER_REAL, &timer, 0);
+    unsigned long events = 0;
+    uint64_t spent = 0;
+    for (uint8_t step = 1; snapshot_reads < 20000; step = step % 7 + 1) {
+        for (uint8_t channel = 0; channel < NUMBER_CHANNELS; channel++, events++) {
+            IRSample sample;
+            // Combo pwm has the address bit in toggle.
+            sample.raw = Simulator::make_frame(channel >> 2, true, channel & 0x3, false, step, step);
+            enqueue(sample);
+        }
+        uint64_t start = Simulator::ticks();
+        update();
+        spent += Simulator::ticks() - start;
+    }
+    timer = { { 0, 0 }, { 0, 0 } };
+    setitimer(ITIMER_REAL, &timer, 0);
+    // Torn plain reads are expected, they are what snapshots are for.
+    failures += snapshot_torn;
+    printf("%-28s %9lu reads %11.1f %s/event, %lu torn (get_state_for_channel %lu), %lu unchanged\n", "snapshots",
+        (unsigned long)snapshot_reads, (double)spent / events, Simulator::ticks_unit(), (unsigned long)snapshot_torn,
+        (unsigned long)plain_torn, (unsigned long)snapshot_skipped);
+}
+#endif
+
+#if IR_SUBSCRIBERS >= 5 && IR_PWM_RC
+// Component subscribing a method, counts its calls and optionally marks events handled, unsubscribes itself or
+// subscribes another one.
+struct Counter {
+    unsigned long calls = 0;
+    bool handles = false;
+    bool once = false;
+    Counter *subscribes = 0;
+    void on_event(IRSample &ir, ChannelState &ch) {
+        (void)ch;
+        calls++;
+        if (handles) ir.handled = true;
+        if (once) unsubscribe(member_handler<Counter, &Counter::on_event>, this);
+        if (subscribes) {
+            subscribe(0, EVENT_RED_CHANGED, member_handler<Counter, &Counter::on_event>, subscribes);
+            subscribes = 0;
+        }
+    }
+};
+
+// update() cost per event of pwm rc increments and decrements for red of channel 0.
+static double subscriber_cost( void ) {
+    bool toggle = false;
+    uint64_t spent = 0;
+    for (unsigned long i = 0; i < BENCH_FRAMES; i++) {
+        IRSample sample;
+        sample.raw = Simulator::make_frame(toggle, false, 0, false, 0x6, i / (2 * DEFAULT_STEPS) & 1 ? 0x5 : 0x4);
+        toggle = !toggle;
+        enqueue(sample);
+        uint64_t start = Simulator::ticks();
+        update();
+        spent += Simulator::ticks() - start;
+    }
+    return (double)spent / BENCH_FRAMES;
+}
+
+/*
+    Subscriptions changed from within a handler: behind a first counter, a counter subscribed twice to red changed of
+    channel 0 unsubscribes both on its first call (and subscribes another one in the second run), a counter subscribed
+    behind them must still be called for every event (as the new one, which must not get one of the unsubscribed
+    slots). Returns the number of wrong counts.
+*/
+static unsigned long resubscribe_check(ContextHandler handler) {
+    unsigned long wrong = 0;
+    for (uint8_t run = 0; run < 2; run++) {
+        Counter first, twice, after, late;
+        twice.once = true;
+        if (run) twice.subscribes = &late;
+        wrong += !subscribe(0, EVENT_RED_CHANGED, handler, &first);
+        wrong += !subscribe(0, EVENT_RED_CHANGED, handler, &twice);
+        wrong += !subscribe(0, EVENT_RED_CHANGED, handler, &twice);
+        wrong += !subscribe(0, EVENT_RED_CHANGED, handler, &after);
+        subscriber_cost();
+        wrong += (twice.calls != 1) + (after.calls != first.calls) + (run && late.calls != first.calls);
+        unsubscribe(handler, &first);
+        unsubscribe(handler, &after);
+        unsubscribe(handler, &late);
+    }
+    return wrong;
+}
+
+/*
+    Counter objects subscribed to red changed of channel 0 (the second one marks events handled, the third must never
+    be called, the fourth unsubscribes itself on its first call) and to all channels' generic events. Times update()
+    without handlers, with a generic_handler and with the subscribers.
+*/
+static void subscribers_scenario( void ) {
+    reset();
+    ContextHandler handler = member_handler<Counter, &Counter::on_event>;
+    unsigned long resubscribe_wrong = resubscribe_check(handler);
+    double cost_none = subscriber_cost();
+    generic_handler = count_handler;
+    double cost_array = subscriber_cost();
+    generic_handler = 0;
+    Counter first, handling, skipped, once, generic;
+    handling.handles = true;
+    once.once = true;
+    unsigned long refused = !subscribe(0, EVENT_RED_CHANGED, handler, &once);
+    refused += !subscribe(0, EVENT_RED_CHANGED, handler, &first);
+    refused += !subscribe(0, EVENT_RED_CHANGED, handler, &handling);
+    refused += !subscribe(0, EVENT_RED_CHANGED, handler, &skipped);
+    refused += !subscribe(ALL_CHANNELS, EVENT_GENERIC, handler, &generic);
+    double cost_subscribed = subscriber_cost();
+    unsigned long wrong = (once.calls != 1) + (skipped.calls != 0) + (first.calls != handling.calls)
+        + (generic.calls != BENCH_FRAMES);
+    unsubscribe(handler, &first);
+    unsubscribe(handler, &handling);
+    unsubscribe(handler, &skipped);
+    unsubscribe(handler, &generic);
+    failures += wrong + refused + resubscribe_wrong;
+    printf("%-28s %9lu calls  %10.1f %s/event (no handlers %.1f, generic_handler %.1f), %lu wrong counts, "
+        "%lu subscriptions refused, %lu wrong after resubscribing\n", "subscribers",
+        first.calls + handling.calls + generic.calls + once.calls, cost_subscribed, Simulator::ticks_unit(), cost_none,
+        cost_array, wrong, refused, resubscribe_wrong);
+}
+#endif
+
+static void update_scenario( void ) {
+    reset();
+    generic_handler = count_handler;
+    unsigned long events = 0;
+    uint64_t spent = 0;
+    for (unsigned long i = 0; i < BENCH_FRAMES; ) {
+        IRSample sample;
+        for (uint8_t slot = 0; slot < IR_QUEUE_SIZE - 1; slot++, i++) {
+            sample.raw = frame(i);
+            if (enqueue(sample)) events++;
+        }
+        uint64_t start = Simulator::ticks();
+        update();
+        spent += Simulator::ticks() - start;
+    }
+    generic_handler = 0;
+    printf("%-28s %9lu events %10.1f %s/event (%lu handler calls)\n", "update()", events,
+        (double)spent / events, Simulator::ticks_unit(), handled);
+}
+
+// All PWM pin pairs set every loop, values change every 16th loop only.
+static void output_scenario( void ) {
+    HostHAL::reset();
+    PowerFunctionsOutput outputs[] = { {PF_OUT_A1}, {PF_OUT_A2}, {PF_OUT_A3}, {PF_OUT_A4}, {PF_OUT_A5}, {PF_OUT_A6},
+        {PF_OUT_A7} };
+    const uint8_t count = sizeof(outputs) / sizeof(outputs[0]);
+    const unsigned long loops = 10000;
+    unsigned long writes = HostHAL::analog_writes;
+    uint64_t start = Simulator::ticks();
+    for (unsigned long i = 0; i < loops; i++) {
+        for (uint8_t o = 0; o < count; o++) outputs[o].set(i >> 4 & 0xFF, 0);
+    }
+    uint64_t direct_spent = Simulator::ticks() - start;
+    unsigned long direct_writes = HostHAL::analog_writes - writes;
+    OutputBank bank;
+    for (uint8_t o = 0; o < count; o++) bank.add(outputs[o]);
+    writes = HostHAL::analog_writes;
+    start = Simulator::ticks();
+    for (unsigned long i = 0; i < loops; i++) {
+        for (uint8_t o = 0; o < count; o++) bank.set(o, i >> 4 & 0xFF, 0);
+        bank.commit();
+    }
+    uint64_t bank_spent = Simulator::ticks() - start;
+    printf("%-28s %9lu writes %10.1f %s/loop\n", "PowerFunctionsOutput::set()", direct_writes,
+        (double)direct_spent / loops, Simulator::ticks_unit());
+    printf("%-28s %9lu writes %10.1f %s/loop (%lu performed, %lu skipped)\n", "OutputBank::commit()",
+        HostHAL::analog_writes - writes, (double)bank_spent / loops, Simulator::ticks_unit(),
+        bank.writes_performed(), bank.writes_skipped());
+}
+
+// Per call cost of the runtime and the compile time pin pair outputs.
+static void output_template_scenario( void ) {
+    HostHAL::reset();
+    const unsigned long calls = 100000;
+    PowerFunctionsOutput runtime(PF_OUT_A1);
+    PowerFunctionsOutputT<PF_OUT_A1> compile_time;
+    uint64_t start = Simulator::ticks();
+    for (unsigned long i = 0; i < calls; i++) runtime.c1_set(i & 0xFF);
+    uint64_t runtime_spent = Simulator::ticks() - start;
+    start = Simulator::ticks();
+    for (unsigned long i = 0; i < calls; i++) compile_time.c1_set(i & 0xFF);
+    uint64_t compile_time_spent = Simulator::ticks() - start;
+    printf("%-28s %10.1f %s/call\n", "PowerFunctionsOutput", (double)runtime_spent / calls, Simulator::ticks_unit());
+    printf("%-28s %10.1f %s/call\n", "PowerFunctionsOutputT", (double)compile_time_spent / calls,
+        Simulator::ticks_unit());
+}
+
+/*
+    Let ticks ramp ticks pass, call PowerFunctionsRamp::update() and check that ramp moved acceleration per tick towards
+    its target (stopping there, late ticks caught up at once) and that output follows the value.
+*/
+static void ramp_step(PowerFunctionsRamp &ramp, PowerFunctionsOutput &output, uint16_t ticks, unsigned long &wrong,
+    uint64_t &spent) {
+    int16_t before = ramp.get_value();
+    int16_t target = ramp.get_target();
+    int32_t step = (int32_t)ramp.get_acceleration() * ticks;
+    int16_t expected = target > before ? (target - before > step ? before + step : target)
+        : (before - target > step ? before - step : target);
+    HostHAL::now_micros += ticks * RAMP_TICK_MS * 1000UL;
+    uint64_t start = Simulator::ticks();
+    PowerFunctionsRamp::update();
+    spent += Simulator::ticks() - start;
+    int16_t value = ramp.get_value();
+    if (value != expected) wrong++;
+    if (output.c1_get() != (value > 0 ? value : 0) || output.c2_get() != (value < 0 ? -value : 0)) wrong++;
+}
+
+/*
+    Ramp with acceleration 10 per tick started 6.5 s after boot: the first update() must not move it (the time since
+    boot isn't ramp time), then towards 255 for 10 ticks, retargeted in place to -100 (20 ticks from 100 down), to 200
+    with 5 ticks late at once and then 10 s without update(), finally without ramp (acceleration 255).
+*/
+static void ramp_scenario( void ) {
+    HostHAL::reset();
+    HostHAL::now_micros = 6500000UL;
+    PowerFunctionsOutput output(PF_OUT_A1);
+    PowerFunctionsRamp ramp(output, 10);
+    unsigned long wrong = 0, updates = 1;
+    uint64_t spent = 0;
+    ramp.set_target(255);
+    ramp_step(ramp, output, 0, wrong, spent);
+    for (uint8_t i = 0; i < 10; i++, updates++) ramp_step(ramp, output, 1, wrong, spent);
+    ramp.set_target(-100);
+    for (uint8_t i = 0; i < 20; i++, updates++) ramp_step(ramp, output, 1, wrong, spent);
+    wrong += !ramp.is_done();
+    ramp.set_target(200);
+    ramp_step(ramp, output, 5, wrong, spent);
+    ramp_step(ramp, output, 10000 / RAMP_TICK_MS, wrong, spent);
+    wrong += !ramp.is_done();
+    ramp.set_acceleration(255);
+    ramp.set_target(-255);
+    ramp_step(ramp, output, 1, wrong, spent);
+    updates += 3;
+    failures += wrong;
+    printf("%-28s %9lu updates %9.1f %s/update, %lu wrong values\n", "PowerFunctionsRamp", updates,
+        (double)spent / updates, Simulator::ticks_unit(), wrong);
+}
+
+// Cost per tick and duty cycle accuracy of the software pwm on the digital pin pairs.
+static void soft_pwm_scenario( void ) {
+    HostHAL::reset();
+    const uint8_t pins[] = { PF_OUT_D1, PF_OUT_D2, PF_OUT_D3 };
+    const uint8_t values[] = { 0, 40, 128, 128, 200, 255 };
+    for (uint8_t i = 0; i < sizeof(pins); i++) {
+        SoftPWM::attach(pins[i]);
+        SoftPWM::write(pins[i], values[i]);
+    }
+    const unsigned long ticks = 100000;
+    unsigned long high[sizeof(pins)] = { 0 };
+    uint64_t spent = 0;
+    for (unsigned long t = 0; t < ticks; t++) {
+        uint64_t start = Simulator::ticks();
+        SoftPWM::tick();
+        spent += Simulator::ticks() - start;
+        for (uint8_t i = 0; i < sizeof(pins); i++) {
+            if (*portOutputRegister(digitalPinToPort(pins[i])) & digitalPinToBitMask(pins[i])) high[i]++;
+        }
+    }
+    printf("%-28s %10.1f %s/tick, duty", "SoftPWM::tick()", (double)spent / ticks, Simulator::ticks_unit());
+    for (uint8_t i = 0; i < sizeof(pins); i++) printf(" %u->%lu", values[i], high[i] * 255 / ticks);
+    // Only full on and off left mid-period: the timer stops, write() has to switch the pins without a tick().
+    unsigned long wrong = 0;
+    for (uint8_t i = 0; i < sizeof(pins); i++) SoftPWM::write(pins[i], i & 1 ? 0 : 255);
+    for (uint8_t i = 0; i < sizeof(pins); i++) {
+        bool on = *portOutputRegister(digitalPinToPort(pins[i])) & digitalPinToBitMask(pins[i]);
+        if (on != !(i & 1)) wrong++;
+    }
+    failures += wrong;
+    printf(", %lu wrong full on/off\n", wrong);
+}
+
+// Samples dispatched by update() in the sender loopback.
+static uint16_t received[64];
+static uint8_t received_count;
+
+static void receive_handler(IRSample &ir, ChannelState &ch) {
+    (void)ch;
+    if (received_count < sizeof(received) / sizeof(received[0])) received[received_count++] = ir.raw;
+}
+
+static void update_between( void ) {
+    update();
+}
+
+// Encode commands with the sender, feed the carrier back into the decoder and compare.
+static void sender_scenario( void ) {
+    reset();
+    init_sender();
+    generic_handler = receive_handler;
+#if IR_FAILSAFE
+    // Commands are sent once, the failsafe would reset the subchannels in between.
+    for (uint8_t channel = 0; channel < NUMBER_CHANNELS; channel++) set_failsafe(channel, 0, 0);
+#endif
+    const unsigned long commands = 2000;
+    unsigned long matched = 0;
+    unsigned long marks = 0;
+    unsigned long start = HostHAL::now_micros;
+    uint64_t spent = Simulator::ticks();
+    for (unsigned long i = 0; i < commands; i++) {
+        received_count = 0;
+        // The sender addresses channels 0-3 only.
+        uint8_t channel = i % (NUMBER_CHANNELS < 4 ? NUMBER_CHANNELS : 4);
+        uint16_t expected;
+        if (IR_PWM_RC && (i % 3 == 2 || !IR_STANDARD_RC)) {
+            bool blue = i >> 2 & 1;
+            uint8_t command = i % 5 == 0 ? RESET_VALUE : i & 8 ? INCREASE_VALUE : DECREASE_VALUE;
+            send_pwm_rc(channel, blue, command);
+            uint8_t mode = (command == RESET_VALUE ? 0x4 : 0x6) | blue;
+            expected = Simulator::make_frame(0, 0, channel, 0, mode, command >> 4);
+        } else {
+            uint8_t red = (i >> 2) % 3;
+            uint8_t blue = (i >> 4) % 3;
+            send_standard_rc(channel, red, blue);
+            expected = Simulator::make_frame(0, 0, channel, 0, 0x1, blue << 2 | red);
+        }
+        marks += Simulator::play_carrier(interrupt_number, carrier_tick, carrier_on, sending, update_between);
+        // Repeats are dropped by update(), so each command has to be dispatched exactly once (toggle bit and checksum
+        // are set by the sender).
+        IRSample sample;
+        sample.raw = received[0];
+        if (received_count == 1 && (sample.raw & 0x7FF0) == (expected & 0x7FF0) && sample.checksum_ok()) matched++;
+    }
+    spent = Simulator::ticks() - spent;
+    generic_handler = 0;
+    failures += commands - matched;
+    printf("%-28s %9lu/%-9lu matched, %lu marks, %.1f s simulated, %.1f %s/mark\n", "sender loopback", matched,
+        commands, marks, (HostHAL::now_micros - start) / 1e6, (double)spent / marks, Simulator::ticks_unit());
+#if IR_STATS
+    Stats stats = get_stats();
+    // update() runs right after each edge here, see latency_scenario() for the latency.
+    printf("%-28s %u handler calls, %u redundant\n", "sender loopback stats", stats.handler_calls, stats.redundant);
+#endif
+}
+
+#if IR_STATS
+// Delay of update() after each frame in the latency scenario (µs).
+#define LATE_UPDATE_US 1000
+
+static void late_update( void ) {
+    HostHAL::now_micros += LATE_UPDATE_US;
+    update();
+}
+
+// Frames with update() called LATE_UPDATE_US after each, every frame's latency must be that.
+static void latency_scenario( void ) {
+    reset();
+    generic_handler = count_handler;
+    Simulator::PulseTrain train(Simulator::Config{});
+    for (uint8_t i = 0; i < 100; i++) {
+        train.add_frame(handled_frame(i));
+        train.add_pause(20000);
+    }
+    reset_stats();
+    train.play(interrupt_number, late_update);
+    generic_handler = 0;
+    Stats stats = get_stats();
+    bool wrong = stats.handler_calls != 100 || stats.latency_min != LATE_UPDATE_US
+        || stats.latency_max != LATE_UPDATE_US || stats.latency_mean != LATE_UPDATE_US;
+    failures += wrong;
+    printf("%-28s %9u calls  latency %lu/%lu/%lu us (min/mean/max), update() %u us late, %s\n", "stats latency",
+        stats.handler_calls, stats.latency_min, stats.latency_mean, stats.latency_max, LATE_UPDATE_US,
+        wrong ? "wrong" : "ok");
+}
+#endif
+
+int main( void ) {
+    printf("IR_DEFERRED_DECODE=%d IR_ADAPTIVE_TIMING=%d IR_COALESCE=%d IR_FAILSAFE=%d IR_BINDINGS=%d IR_SNAPSHOTS=%d IR_SUBSCRIBERS=%d IR_PREFILTER=%d IR_STATS=%d IR_QUEUE_SIZE=%d IR_CHANNELS=%d receivers=%d, %u bytes RAM (host)\n",
+        IR_DEFERRED_DECODE, IR_ADAPTIVE_TIMING, IR_COALESCE, IR_FAILSAFE, IR_BINDINGS, IR_SNAPSHOTS, IR_SUBSCRIBERS, IR_PREFILTER, IR_STATS, IR_QUEUE_SIZE, IR_CHANNELS, NUMBER_RECEIVERS, get_ram_footprint());
+    printf("%-28s %19s %7s %21s %19s\n", "scenario", "decoded/sent", "valid", "isr cost", "throughput");
+    Simulator::Config config;
+    decode_scenario("clean", config);
+    config.repeats = 5;
+    config.pf_pauses = true;
+    decode_scenario("pf repeats", config);
+    config = Simulator::Config();
+    char name[32];
+    for (uint16_t jitter = 50; jitter <= 250; jitter += 50) {
+        config.jitter_us = jitter;
+        snprintf(name, sizeof(name), "jitter +-%uus", jitter);
+        decode_scenario(name, config);
+    }
+    config = Simulator::Config();
+    for (uint16_t skew = 750; skew <= 1250; skew += 100) {
+        config.skew_permille = skew;
+        snprintf(name, sizeof(name), "skew %u.%u%%", skew / 10, skew % 10);
+        decode_scenario(name, config);
+    }
+    config = Simulator::Config();
+    for (uint8_t noise = 1; noise <= 4; noise *= 2) {
+        config.noise_percent = noise;
+        snprintf(name, sizeof(name), "noise %u%%/interval", noise);
+        decode_scenario(name, config);
+    }
+#if NUMBER_RECEIVERS > 1
+    for (uint8_t noise = 1; noise <= 4; noise *= 2) receivers_scenario(noise);
+#endif
+    update_scenario();
+#if IR_PWM_RC && NUMBER_CHANNELS >= 2
+    burst_scenario();
+#endif
+    budget_scenario();
+    // The following scenarios need the modes and number of subscribers they use.
+#if IR_FAILSAFE && IR_STANDARD_RC
+    failsafe_scenario();
+#endif
+#if IR_BINDINGS && IR_PWM_RC
+    bindings_scenario();
+#endif
+#if IR_SNAPSHOTS && IR_PWM_RC
+    snapshot_scenario();
+#endif
+#if IR_SUBSCRIBERS >= 5 && IR_PWM_RC
+    subscribers_scenario();
+#endif
+    output_scenario();
+    output_template_scenario();
+    ramp_scenario();
+    soft_pwm_scenario();
+    sender_scenario();
+#if IR_STATS
+    latency_scenario();
+#endif
+    printf("%lu failures\n", failures);
+    return failures ? 1 : 0;
+}
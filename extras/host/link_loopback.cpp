@@ -0,0 +1,215 @@
+/*
+ * link_loopback.cpp - Loopback test of the BrixxLink serial protocol on the host
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ *
+ * The device side (BrixxLink, PowerFunctionsIR and two PowerFunctionsOutput ports) is connected to a host side
+ * encoder and FrameParser by an in-memory serial port that takes a limited number of bytes per loop() iteration.
+ * Host commands inject IR events and drive the outputs, every telemetry frame is checked against the device state.
+ * Some host frames are corrupted on the way and have to be rejected by the CRC. Exits with 1 on any mismatch.
+ */
+#include "Arduino.h"
+#include "BrixxLink.h"
+#include "Simulator.h"
+#include <stdio.h>
+#include <deque>
+#include <vector>
+
+using namespace BrixxLink;
+using PowerFunctionsIR::IRSample;
+using PowerFunctionsIR::ChannelState;
+
+// Bytes the port takes per loop() iteration (115200 baud for 3 ms).
+#define PORT_BYTES_PER_LOOP 33
+
+/*
+    In-memory serial port, the device's side.
+*/
+class LoopbackPort : public Stream
+{
+  public:
+    std::deque<uint8_t> to_device;
+    std::deque<uint8_t> to_host;
+    int room = 0;
+    size_t write( uint8_t value ) {
+        if (room <= 0) fail("write() blocked");
+        room--;
+        to_host.push_back(value);
+        return 1;
+    }
+    int availableForWrite( void ) { return room; }
+    int available( void ) { return to_device.size(); }
+    int read( void ) {
+        if (to_device.empty()) return -1;
+        uint8_t value = to_device.front();
+        to_device.pop_front();
+        return value;
+    }
+    int peek( void ) { return to_device.empty() ? -1 : to_device.front(); }
+    static void fail( const char* what ) {
+        fprintf(stderr, "link_loopback: %s\n", what);
+        failures++;
+    }
+    static unsigned long failures;
+};
+
+unsigned long LoopbackPort::failures;
+
+static LoopbackPort port;
+static FrameParser host_parser;
+
+// IR events as seen by the device's handler, telemetry frames have to match them in order.
+static std::deque<std::vector<uint8_t> > expected_events;
+static unsigned long statuses[LINK_UNKNOWN_TYPE + 1];
+static unsigned long events_checked;
+static unsigned long outputs_checked;
+static uint8_t output_values[2][2];
+// Values set by the host per output and not yet seen in a LINK_OUTPUT frame, the device may skip some.
+static std::deque<std::vector<uint8_t> > output_history[2];
+
+static void device_handler(IRSample &ir, ChannelState &state) {
+    std::vector<uint8_t> event = { (uint8_t)(ir.raw & 0xFF), (uint8_t)(ir.raw >> 8), (uint8_t)state.red.actual_step,
+        (uint8_t)state.blue.actual_step };
+    if (send_ir_event(ir, state)) expected_events.push_back(event);
+}
+
+// Encode a host command.
+static void host_send(uint8_t type, const std::vector<uint8_t> &payload, bool corrupt = false) {
+    std::vector<uint8_t> frame = { LINK_SYNC, (uint8_t)(type << 4 | payload.size()) };
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    uint8_t crc = 0;
+    for (size_t i = 1; i < frame.size(); i++) crc = crc8(crc, frame[i]);
+    frame.push_back(crc);
+    if (corrupt) frame[frame.size() - 2] ^= 0x10;
+    port.to_device.insert(port.to_device.end(), frame.begin(), frame.end());
+}
+
+static void host_receive( void ) {
+    while (!port.to_host.empty()) {
+        uint8_t byte = port.to_host.front();
+        port.to_host.pop_front();
+        if (!host_parser.feed(byte)) continue;
+        const uint8_t *p = host_parser.payload();
+        switch (host_parser.type()) {
+            case LINK_IR_EVENT:
+                if (expected_events.empty() || std::vector<uint8_t>(p, p + 4) != expected_events.front()) {
+                    LoopbackPort::fail("ir event frame differs");
+                } else {
+                    expected_events.pop_front();
+                }
+                events_checked++;
+                break;
+            case LINK_OUTPUT:
+                if (p[0] > 1) {
+                    LoopbackPort::fail("output frame index differs");
+                    break;
+                }
+                {
+                    std::deque<std::vector<uint8_t> > &history = output_history[p[0]];
+                    while (!history.empty() && history.front() != std::vector<uint8_t>(p + 1, p + 3)) {
+                        history.pop_front();
+                    }
+                    if (history.empty()) LoopbackPort::fail("output frame differs");
+                }
+                outputs_checked++;
+                break;
+            case LINK_STATUS:
+                if (p[1] <= LINK_UNKNOWN_TYPE) statuses[p[1]]++;
+                break;
+            default:
+                LoopbackPort::fail("unexpected frame type");
+        }
+    }
+}
+
+// One iteration of the device's loop() and the host reading the port.
+static void loop_once( void ) {
+    HostHAL::now_micros += 3000;
+    port.room = PORT_BYTES_PER_LOOP;
+    PowerFunctionsIR::update();
+    update();
+    host_receive();
+}
+
+int main( void ) {
+    HostHAL::reset();
+    PowerFunctionsIR::init();
+    PowerFunctionsIR::generic_handler = device_handler;
+    init(port);
+    PowerFunctionsOutput out_a(PF_OUT_A1);
+    PowerFunctionsOutput out_b(PF_OUT_A2);
+    add_output(out_a);
+    add_output(out_b);
+    output_history[0].push_back({ 0, 0 });
+    output_history[1].push_back({ 0, 0 });
+    for (int i = 0; i < 10; i++) loop_once();
+
+    // IR events injected by the host, every 7th frame corrupted on the wire.
+#if IR_STATS
+    PowerFunctionsIR::reset_stats();
+#endif
+    unsigned long injected = 0, corrupted = 0;
+    for (unsigned long i = 0; i < 2000; i++) {
+        uint16_t raw = Simulator::make_frame(i & 1, false, i >> 1 & 0x3, false, 0x1, i >> 3 & 0xF);
+        bool corrupt = i % 7 == 6;
+        host_send(LINK_INJECT_IR, { (uint8_t)(raw & 0xFF), (uint8_t)(raw >> 8) }, corrupt);
+        if (corrupt) corrupted++;
+        else injected++;
+        loop_once();
+    }
+#if IR_STATS
+    // Injected frames are dispatched by the loop() after the one they arrived in.
+    if (PowerFunctionsIR::get_stats().latency_max > 3000) LoopbackPort::fail("injected frame with stale timestamp");
+#endif
+#if IR_PREFILTER
+    // A repeated frame is dropped by the pre-filter before it's queued, just like a received one.
+    uint16_t repeated = PowerFunctionsIR::get_prefilter_drops().repeated;
+    for (uint8_t i = 0; i < 2; i++, injected++) {
+        uint16_t raw = Simulator::make_frame(false, false, 0, false, 0x1, 0x6);
+        host_send(LINK_INJECT_IR, { (uint8_t)(raw & 0xFF), (uint8_t)(raw >> 8) });
+        loop_once();
+    }
+    if (PowerFunctionsIR::get_prefilter_drops().repeated != repeated + 1) {
+        LoopbackPort::fail("injected frame bypassed the pre-filter");
+    }
+#endif
+    // Outputs driven by the host, the device reports the values it set.
+    for (unsigned long i = 0; i < 500; i++) {
+        uint8_t index = i & 1;
+        output_values[index][0] = i * 13;
+        output_values[index][1] = i * 7;
+        output_history[index].push_back({ output_values[index][0], output_values[index][1] });
+        host_send(LINK_SET_OUTPUT, { index, output_values[index][0], output_values[index][1] });
+        loop_once();
+        if (out_a.c1_get() != output_values[0][0] || out_b.c2_get() != output_values[1][1]) {
+            if (i > 0) LoopbackPort::fail("output not set");
+        }
+    }
+    host_send(LINK_SET_OUTPUT, { 5, 0, 0 });
+    host_send(LINK_PING, {});
+    for (int i = 0; i < 100; i++) loop_once();
+    if (!expected_events.empty()) LoopbackPort::fail("ir event frames missing");
+    if (get_crc_errors() != corrupted) LoopbackPort::fail("corrupted frames not rejected");
+    if (host_parser.crc_errors()) LoopbackPort::fail("telemetry frame with bad CRC");
+    if (statuses[LINK_OK] != injected + 500 + 1 || statuses[LINK_BAD_INDEX] != 1) {
+        LoopbackPort::fail("status frames missing");
+    }
+
+    // Flooding the send buffer drops whole frames only.
+    uint16_t dropped = get_dropped_frames();
+    for (unsigned long i = 0; i < 1000; i++) {
+        IRSample ir;
+        ir.raw = Simulator::make_frame(i & 1, false, 0, false, 0x1, i & 0xF);
+        ChannelState state = PowerFunctionsIR::get_state_for_channel(0);
+        device_handler(ir, state);
+        if (i % 10 == 9) loop_once();
+    }
+    for (int i = 0; i < 100; i++) loop_once();
+    if (!expected_events.empty() || host_parser.crc_errors()) LoopbackPort::fail("flooding broke frames");
+
+    printf("link loopback: %lu ir events, %lu output frames, %lu ok / %lu bad index statuses, %u host frames rejected, "
+        "%u frames dropped while flooding, %lu failures\n", events_checked, outputs_checked, statuses[LINK_OK],
+        statuses[LINK_BAD_INDEX], get_crc_errors(), get_dropped_frames() - dropped, LoopbackPort::failures);
+    return LoopbackPort::failures ? 1 : 0;
+}
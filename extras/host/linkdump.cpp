@@ -0,0 +1,82 @@
+/*
+ * linkdump.cpp - Host side decoder of the BrixxLink serial protocol
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ *
+ * Prints the frames of a byte stream written by BrixxLink (device -> host) or by a host (host -> device), one line
+ * per frame, e.g. from the Arduino's serial port:
+ *
+ *   stty -F /dev/ttyACM0 115200 raw -echo && ./build/linkdump /dev/ttyACM0
+ *   linkdump [FILE]  - decode FILE (default stdin), frames with bad CRC are counted on stderr at the end
+ */
+#include "Arduino.h"
+#include "BrixxLink.h"
+#include <stdio.h>
+
+using namespace BrixxLink;
+
+static uint16_t le16(const uint8_t *bytes) {
+    return bytes[0] | bytes[1] << 8;
+}
+
+static void print_frame(const FrameParser &parser) {
+    const uint8_t *p = parser.payload();
+    uint8_t length = parser.length();
+    switch (parser.type()) {
+        case LINK_IR_EVENT:
+            if (length != 4) break;
+            {
+                PowerFunctionsIR::IRSample ir;
+                ir.raw = le16(p);
+                printf("ir_event     ch%u raw=0x%04x red=%d blue=%d\n", ir.get_channel(), ir.raw, (int8_t)p[2],
+                    (int8_t)p[3]);
+            }
+            return;
+        case LINK_OUTPUT:
+            if (length != 3) break;
+            printf("output       %u c1=%u c2=%u\n", p[0], p[1], p[2]);
+            return;
+        case LINK_STATUS:
+            if (length != 6) break;
+            printf("status       type=0x%x result=%u dropped=%u crc_errors=%u\n", p[0], p[1], le16(p + 2),
+                le16(p + 4));
+            return;
+        case LINK_SET_OUTPUT:
+            if (length != 3) break;
+            printf("set_output   %u c1=%u c2=%u\n", p[0], p[1], p[2]);
+            return;
+        case LINK_INJECT_IR:
+            if (length != 2) break;
+            printf("inject_ir    raw=0x%04x\n", le16(p));
+            return;
+        case LINK_PING:
+            if (length != 0) break;
+            printf("ping\n");
+            return;
+    }
+    printf("unknown      type=0x%x length=%u\n", parser.type(), length);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-' && argv[1][1])) {
+        fprintf(stderr, "usage: %s [FILE]\n", argv[0]);
+        return 2;
+    }
+    FILE* file = argc == 2 && argv[1][0] != '-' ? fopen(argv[1], "rb") : stdin;
+    if (!file) {
+        perror(argv[1]);
+        return 1;
+    }
+    FrameParser parser;
+    unsigned long frames = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        if (!parser.feed(c)) continue;
+        print_frame(parser);
+        fflush(stdout);
+        frames++;
+    }
+    fprintf(stderr, "%lu frames, %u with bad CRC\n", frames, parser.crc_errors());
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * replay.cpp - Replay captured IR sessions through the PowerFunctionsIR decoder on the host
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ *
+ * Captures are the bytes written by PowerFunctionsIR::dump_capture() (IR_CAPTURE, format see PowerFunctionsIR.h).
+ * Each interval is fired on the decoder's interrupt routine followed by update(), without waiting for real time.
+ * Every event handler call is printed to stdout, so the traces of two decoder versions can be compared with diff.
+ *
+ *   replay CAPTURE...        - replay captures, a summary per capture is printed to stderr
+ *   replay --record CAPTURE  - decode a simulated session (repeats, jitter, noise), print its trace and write the
+ *                              capture of it, replaying the capture has to print the same trace
+ */
+#include "Arduino.h"
+#include "Simulator.h"
+#include "PowerFunctionsIR.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace PowerFunctionsIR;
+
+#if !IR_CAPTURE
+#error "replay needs IR_CAPTURE=1"
+#endif
+
+// Handler calls printed so far.
+static unsigned long calls;
+
+static void trace(const char* handler, IRSample &ir, ChannelState &ch) {
+    printf("%6lu %-13s ch%u raw=0x%04x red=%d blue=%d\n", calls++, handler, ir.get_channel(), ir.raw,
+        ch.red.actual_step, ch.blue.actual_step);
+}
+
+static void generic(IRSample &ir, ChannelState &ch) { trace("generic", ir, ch); }
+static void red_effected(IRSample &ir, ChannelState &ch) { trace("red_effected", ir, ch); }
+static void blue_effected(IRSample &ir, ChannelState &ch) { trace("blue_effected", ir, ch); }
+static void red_changed(IRSample &ir, ChannelState &ch) { trace("red_changed", ir, ch); }
+static void blue_changed(IRSample &ir, ChannelState &ch) { trace("blue_changed", ir, ch); }
+
+static void attach_handlers( void ) {
+    generic_handler = generic;
+    for (uint8_t i = 0; i < NUMBER_CHANNELS; i++) {
+        red_effected_handler[i] = red_effected;
+        blue_effected_handler[i] = blue_effected;
+        red_changed_handler[i] = red_changed;
+        blue_changed_handler[i] = blue_changed;
+    }
+}
+
+// Fire one edge interval after the previous edge (micros() keeps running across captures).
+static void fire(uint16_t micros_diff) {
+    uint8_t interrupt = digitalPinToInterrupt(IR_SAMPLE_INTERRUPT_PIN);
+    HostHAL::fire(interrupt, HostHAL::now_micros + micros_diff);
+    update();
+    // The capture of the replay itself isn't needed.
+    uint8_t buffer[32];
+    while (read_capture(buffer, sizeof(buffer)));
+}
+
+static int replay(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    unsigned long edges = 0, lost = 0, simulated = 0;
+    unsigned long first_call = calls;
+    uint64_t wall = Simulator::nanos();
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        uint16_t units = c;
+        if (units >= CAPTURE_ESCAPE) {
+            int second = fgetc(file);
+            if (second == EOF) {
+                fprintf(stderr, "%s: truncated interval at the end\n", path);
+                break;
+            }
+            units = (units & 0x0F) << 8 | second;
+            if (units == (CAPTURE_LOST & 0x0FFF)) {
+                lost++;
+                units = CAPTURE_LONG_GAP & 0x0FFF;
+            }
+        }
+        fire(units << 2);
+        simulated += units << 2;
+        edges++;
+    }
+    wall = Simulator::nanos() - wall;
+    fclose(file);
+    fprintf(stderr, "%s: %lu edges, %lu lost markers, %lu handler calls, %.1f s of intervals in %.3f s\n", path,
+        edges, lost, calls - first_call, simulated / 1e6, wall / 1e9);
+    return 0;
+}
+
+// Writes the capture to a file.
+class FilePrint : public Print
+{
+  public:
+    FilePrint( FILE* file ) : _file(file) {}
+    size_t write( uint8_t value ) { return fputc(value, _file) == EOF ? 0 : 1; }
+    size_t write( const uint8_t *buffer, size_t size ) { return fwrite(buffer, 1, size, _file); }
+  private:
+    FILE* _file;
+};
+
+static FilePrint* record_out;
+
+static void record_between( void ) {
+    update();
+    dump_capture(*record_out);
+}
+
+static int record(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    FilePrint out(file);
+    record_out = &out;
+    Simulator::Config config;
+    config.repeats = 5;
+    config.pf_pauses = true;
+    config.jitter_us = 100;
+    config.noise_percent = 1;
+    Simulator::PulseTrain train(config);
+    for (unsigned long i = 0; i < 2000; i++) {
+        uint8_t channel = i >> 1 & 0x3;
+        if (i % 4 == 3) {
+            // PWM rc: increment / decrement (mode 0x6 / 0x7, data 4 / 5) and reset (mode 0x4 / 0x5, data 8).
+            uint8_t data = i % 5 == 0 ? 0x8 : 0x4 | (i >> 3 & 1);
+            train.add_frame(Simulator::make_frame(i & 1, false, channel, false, (data == 0x8 ? 0x4 : 0x6) | (i >> 4 & 1),
+                data));
+        } else {
+            // Standard rc: float / forward / backward / brake for red and blue.
+            train.add_frame(Simulator::make_frame(i & 1, false, channel, false, 0x1, (i * 7 >> 2) & 0xF));
+        }
+        if (i % 50 == 49) train.add_pause(200000);
+    }
+    train.play(digitalPinToInterrupt(IR_SAMPLE_INTERRUPT_PIN), record_between);
+    fclose(file);
+    fprintf(stderr, "%s: recorded %lu edges, %lu handler calls\n", path, (unsigned long)train.edges(), calls);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    HostHAL::reset();
+    init();
+    attach_handlers();
+    if (argc == 3 && !strcmp(argv[1], "--record")) return record(argv[2]);
+    if (argc < 2 || argv[1][0] == '-') {
+        fprintf(stderr, "usage: %s CAPTURE...\n       %s --record CAPTURE\n", argv[0], argv[0]);
+        return 2;
+    }
+    int result = 0;
+    for (int i = 1; i < argc; i++) result |= replay(argv[i]);
+    return result;
+}
@@ -16,5 +16,11 @@
 
 #include "BrixxSettings.h"
 #include "PowerFunctionsIR.h"
+#include "PowerFunctionsIRSender.h"
 #include "PowerFunctionsOutput.h"
+#include "PowerFunctionsOutputT.h"
+#include "OutputBank.h"
+#include "SoftPWM.h"
+#include "PowerFunctionsRamp.h"
+#include "BrixxLink.h"
 //#include "PowerFunctionsMotor.h"
@@ -0,0 +1,212 @@
+/*
+ * BrixxLink.cpp - Compact binary serial protocol between the Brixx library and a host companion (e.g. Raspberry Pi)
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ * Note: Although this project aims to connect LEGO Power Functions hardware to Arduino without damaging anything else
+ * then just a few extension cables, I'll take no responsibility for any damage done to any of your hardware.
+ * Warranty for your LEGO Power Functions items may void using this project.
+ */
+#include "BrixxLink.h"
+
+namespace BrixxLink {
+
+static_assert(LINK_TX_BUFFER_SIZE >= 16 && LINK_TX_BUFFER_SIZE <= 128
+    && (LINK_TX_BUFFER_SIZE & (LINK_TX_BUFFER_SIZE - 1)) == 0, "LINK_TX_BUFFER_SIZE must be a power of 2 (16-128)");
+static_assert(LINK_OUTPUTS >= 1 && LINK_OUTPUTS <= 127, "LINK_OUTPUTS must be 1-127");
+
+/*
+    Variables.
+*/
+// Serial port to the host.
+Stream* link_port;
+// Send ring, free running read (head) and write (tail) positions, only used from loop() context.
+uint8_t tx_buffer[LINK_TX_BUFFER_SIZE];
+uint8_t tx_head;
+uint8_t tx_tail;
+// CRC of the frame being written.
+uint8_t tx_crc;
+uint16_t dropped_frames;
+// Host commands.
+FrameParser rx_parser;
+// Added outputs and their values sent last.
+PowerFunctionsOutput* outputs[LINK_OUTPUTS];
+uint8_t output_sent[LINK_OUTPUTS][2];
+uint8_t output_count;
+
+/*
+    CRC-8, polynomial 0x07, one nibble at a time.
+*/
+static const uint8_t crc_nibbles[16] PROGMEM = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+uint8_t crc8(uint8_t crc, uint8_t byte) {
+    crc ^= byte;
+    crc = crc << 4 ^ pgm_read_byte(&crc_nibbles[crc >> 4]);
+    return crc << 4 ^ pgm_read_byte(&crc_nibbles[crc >> 4]);
+}
+
+bool FrameParser::feed(uint8_t byte) {
+    if (_received == 0) {
+        if (byte == LINK_SYNC) _received = 1;
+        return false;
+    }
+    if (_received == 1) {
+        _header = byte;
+        _crc = crc8(0, byte);
+        _received = 2;
+        return false;
+    }
+    if (_received - 2 < length()) {
+        _payload[_received - 2] = byte;
+        _crc = crc8(_crc, byte);
+        _received++;
+        return false;
+    }
+    // CRC byte.
+    _received = 0;
+    if (byte == _crc) return true;
+    _crc_errors++;
+    return false;
+}
+
+/*
+    Writing frames into the send ring, a frame is only published (tx_tail) when it was completely written.
+*/
+// Reserve room for a frame with length payload bytes and write its start, false (frame dropped) if it doesn't fit.
+static bool begin_frame(uint8_t type, uint8_t length, uint8_t &tail) {
+    if (!link_port || (uint8_t)(LINK_TX_BUFFER_SIZE - (uint8_t)(tx_tail - tx_head)) < length + 3) {
+        dropped_frames++;
+        return false;
+    }
+    tail = tx_tail;
+    uint8_t header = type << 4 | length;
+    tx_buffer[tail++ & (LINK_TX_BUFFER_SIZE - 1)] = LINK_SYNC;
+    tx_buffer[tail++ & (LINK_TX_BUFFER_SIZE - 1)] = header;
+    tx_crc = crc8(0, header);
+    return true;
+}
+
+static inline void put(uint8_t byte, uint8_t &tail) {
+    tx_buffer[tail++ & (LINK_TX_BUFFER_SIZE - 1)] = byte;
+    tx_crc = crc8(tx_crc, byte);
+}
+
+static inline void end_frame(uint8_t tail) {
+    tx_buffer[tail++ & (LINK_TX_BUFFER_SIZE - 1)] = tx_crc;
+    tx_tail = tail;
+}
+
+bool send_ir_event(const PowerFunctionsIR::IRSample &ir, const PowerFunctionsIR::ChannelState &state) {
+    uint8_t tail;
+    if (!begin_frame(LINK_IR_EVENT, 4, tail)) return false;
+    uint16_t raw = ir.raw;
+    put(raw & 0xFF, tail);
+    put(raw >> 8, tail);
+    put(state.red.actual_step, tail);
+    put(state.blue.actual_step, tail);
+    end_frame(tail);
+    return true;
+}
+
+bool send_output(uint8_t index) {
+    if (index >= output_count) return false;
+    uint8_t tail;
+    if (!begin_frame(LINK_OUTPUT, 3, tail)) return false;
+    uint8_t c1 = outputs[index]->c1_get();
+    uint8_t c2 = outputs[index]->c2_get();
+    put(index, tail);
+    put(c1, tail);
+    put(c2, tail);
+    end_frame(tail);
+    output_sent[index][0] = c1;
+    output_sent[index][1] = c2;
+    return true;
+}
+
+static void send_status(uint8_t type, uint8_t result) {
+    uint8_t tail;
+    if (!begin_frame(LINK_STATUS, 6, tail)) return;
+    put(type, tail);
+    put(result, tail);
+    put(dropped_frames & 0xFF, tail);
+    put(dropped_frames >> 8, tail);
+    put(rx_parser.crc_errors() & 0xFF, tail);
+    put(rx_parser.crc_errors() >> 8, tail);
+    end_frame(tail);
+}
+
+void ir_event_handler(PowerFunctionsIR::IRSample &ir, PowerFunctionsIR::ChannelState &state) {
+    send_ir_event(ir, state);
+}
+
+/*
+    Host commands.
+*/
+static uint8_t execute(uint8_t type, uint8_t length, const uint8_t *payload) {
+    switch (type) {
+        case LINK_SET_OUTPUT:
+            if (length != 3) return LINK_BAD_LENGTH;
+            if (payload[0] >= output_count) return LINK_BAD_INDEX;
+            outputs[payload[0]]->set(payload[1], payload[2]);
+            return LINK_OK;
+        case LINK_INJECT_IR: {
+            if (length != 2) return LINK_BAD_LENGTH;
+            PowerFunctionsIR::IRSample sample;
+            sample.raw = payload[0] | payload[1] << 8;
+            // Same path as received frames, submit() locks out the IR interrupt routines (single queue producer).
+            return PowerFunctionsIR::submit(sample) ? LINK_OK : LINK_QUEUE_FULL;
+        }
+        case LINK_PING:
+            return length ? LINK_BAD_LENGTH : LINK_OK;
+        default:
+            return LINK_UNKNOWN_TYPE;
+    }
+}
+
+/*
+    User interface functions.
+*/
+void init(Stream &port) {
+    link_port = &port;
+    tx_head = tx_tail;
+}
+
+int8_t add_output(PowerFunctionsOutput &output) {
+    if (output_count >= LINK_OUTPUTS) return -1;
+    uint8_t index = output_count++;
+    outputs[index] = &output;
+    // Differ from the current values, so they are sent by the next update().
+    output_sent[index][0] = ~output.c1_get();
+    output_sent[index][1] = ~output.c2_get();
+    return index;
+}
+
+void update( void ) {
+    if (!link_port) return;
+    // Host commands, bounded by the serial port's receive buffer.
+    while (link_port->available() > 0) {
+        if (rx_parser.feed(link_port->read())) {
+            send_status(rx_parser.type(), execute(rx_parser.type(), rx_parser.length(), rx_parser.payload()));
+        }
+    }
+    for (uint8_t i = 0; i < output_count; i++) {
+        if (outputs[i]->c1_get() != output_sent[i][0] || outputs[i]->c2_get() != output_sent[i][1]) send_output(i);
+    }
+    // Only as many bytes as the port takes without blocking.
+    int room = link_port->availableForWrite();
+    uint8_t head = tx_head;
+    while (room-- > 0 && head != tx_tail) link_port->write(tx_buffer[head++ & (LINK_TX_BUFFER_SIZE - 1)]);
+    tx_head = head;
+}
+
+uint16_t get_dropped_frames( void ) {
+    return dropped_frames;
+}
+
+uint16_t get_crc_errors( void ) {
+    return rx_parser.crc_errors();
+}
+
+}; // end namespace
@@ -0,0 +1,107 @@
+/*
+ * BrixxLink.h - Compact binary serial protocol between the Brixx library and a host companion (e.g. Raspberry Pi)
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ * Note: Although this project aims to connect LEGO Power Functions hardware to Arduino without damaging anything else
+ * then just a few extension cables, I'll take no responsibility for any damage done to any of your hardware.
+ * Warranty for your LEGO Power Functions items may void using this project.
+ *
+ *   - Frames are LINK_SYNC, a header byte (type << 4 | payload length), 0-15 payload bytes and a CRC-8 (polynomial
+ *     0x07, initial value 0) over header and payload. Multi byte values are little endian.
+ *   - Telemetry frames are written into a ring of LINK_TX_BUFFER_SIZE bytes straight from IRSample, ChannelState and
+ *     PowerFunctionsOutput. Frames that don't fit are dropped and counted, sending never blocks.
+ *   - update() (in loop() function) hands buffered bytes to the port as far as availableForWrite() allows, parses
+ *     received host commands and sends the values of added outputs that changed.
+ *   - Each host command is answered by a LINK_STATUS frame.
+ *
+ *   Device -> host                payload
+ *   LINK_IR_EVENT    IRSample raw (2), red actual_step, blue actual_step (int8)
+ *   LINK_OUTPUT      output index, c1 value, c2 value
+ *   LINK_STATUS      command type answered, result (LINK_OK, ...), dropped frames (2), frames with bad CRC (2)
+ *
+ *   Host -> device
+ *   LINK_SET_OUTPUT  output index, c1 value, c2 value (set on the PowerFunctionsOutput added with that index)
+ *   LINK_INJECT_IR   IRSample raw (2), handed on like a received IR frame (PowerFunctionsIR::submit(), through the
+ *                    pre-filter, checksum is checked by update() or the pre-filter)
+ *   LINK_PING        no payload
+ */
+#pragma once
+#include "Arduino.h"
+#include "BrixxSettings.h"
+#include "PowerFunctionsIR.h"
+#include "PowerFunctionsOutput.h"
+
+namespace BrixxLink {
+
+/*
+    Framing.
+*/
+#define LINK_SYNC                   0xB5
+#define LINK_MAX_PAYLOAD              15
+/*
+    Frame types (high nibble of the header byte).
+*/
+#define LINK_IR_EVENT                0x1
+#define LINK_OUTPUT                  0x2
+#define LINK_STATUS                  0x3
+#define LINK_SET_OUTPUT              0x8
+#define LINK_INJECT_IR               0x9
+#define LINK_PING                    0xA
+/*
+    Results in LINK_STATUS frames.
+*/
+#define LINK_OK                        0
+#define LINK_BAD_LENGTH                1
+#define LINK_BAD_INDEX                 2
+#define LINK_QUEUE_FULL                3
+#define LINK_UNKNOWN_TYPE              4
+
+// Add byte to a CRC-8 (polynomial 0x07).
+uint8_t crc8(uint8_t crc, uint8_t byte);
+
+/*
+    FrameParser class - reassembles frames from a byte stream, used for host commands and by host side decoders.
+    Bytes before a LINK_SYNC are skipped, a frame with bad CRC is dropped and the search for LINK_SYNC starts after it
+    (the frame following a corrupted length may be lost, the host repeats commands without LINK_STATUS answer).
+*/
+class FrameParser
+{
+  public:
+    // Feed the next byte, true if it completed a frame (see type(), length() and payload()).
+    bool feed( uint8_t byte );
+    uint8_t type( void ) const { return _header >> 4; }
+    uint8_t length( void ) const { return _header & 0x0F; }
+    const uint8_t* payload( void ) const { return _payload; }
+    // Frames dropped for a bad CRC.
+    uint16_t crc_errors( void ) const { return _crc_errors; }
+  private:
+    // Bytes of the current frame received, 0 = waiting for LINK_SYNC.
+    uint8_t _received = 0;
+    uint8_t _header = 0;
+    uint8_t _crc = 0;
+    uint8_t _payload[LINK_MAX_PAYLOAD];
+    uint16_t _crc_errors = 0;
+};
+
+/*
+    User interface functions.
+*/
+// Call BrixxLink::init() in setup() with the serial port to the host (after Serial.begin()).
+void init( Stream &port );
+// Call BrixxLink::update() in loop() to send buffered frames and process host commands.
+void update( void );
+// Add an output the host can drive and whose values are sent when they change, returns its index or -1 if
+// LINK_OUTPUTS outputs were added.
+int8_t add_output( PowerFunctionsOutput &output );
+// Buffer a LINK_IR_EVENT frame, false if it was dropped.
+bool send_ir_event( const PowerFunctionsIR::IRSample &ir, const PowerFunctionsIR::ChannelState &state );
+// Buffer a LINK_OUTPUT frame with the current values of output index, false if it was dropped.
+bool send_output( uint8_t index );
+// Event handler sending each IR event, e.g. PowerFunctionsIR::generic_handler = BrixxLink::ir_event_handler.
+void ir_event_handler( PowerFunctionsIR::IRSample &ir, PowerFunctionsIR::ChannelState &state );
+// Frames dropped because the send buffer was full and host frames dropped for a bad CRC.
+uint16_t get_dropped_frames( void );
+uint16_t get_crc_errors( void );
+
+}; // end namespace
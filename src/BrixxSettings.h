@@ -18,10 +18,126 @@
 #ifndef IR_SAMPLE_INTERRUPT_PIN
 #define IR_SAMPLE_INTERRUPT_PIN 18
 #endif
+// External interrupt pins of all IR receivers (comma separated, Arduino Mega: 2, 3, 18, 19, 20, 21), identical frames
+// decoded by several receivers within IR_MERGE_WINDOW_US (µs) are merged, so event handlers are called once
+#ifndef IR_RECEIVER_PINS
+#define IR_RECEIVER_PINS        IR_SAMPLE_INTERRUPT_PIN
+#endif
+// Maximum number of IR_RECEIVER_PINS, the external interrupts of the board (Arduino Mega: 6), pins without an external
+// interrupt are left unattached by PowerFunctionsIR::init()
+#ifndef IR_MAX_RECEIVERS
+#define IR_MAX_RECEIVERS        6
+#endif
+#ifndef IR_MERGE_WINDOW_US
+#define IR_MERGE_WINDOW_US   16000
+#endif
+// Learn the low, high and start-stop intervals of accepted frames per receiver and derive the bit timing thresholds
+// from them (within 75-125% of the typical intervals), see PowerFunctionsIR::get_bit_timing() (0 = fixed thresholds)
+#ifndef IR_ADAPTIVE_TIMING
+#define IR_ADAPTIVE_TIMING       0
+#endif
 // Default steps count for pwm in-/decrease events
 #ifndef DEFAULT_STEPS
 #define DEFAULT_STEPS            7
 #endif
+// Number of channels handled (1-8), channel_states and the event handler tables have one element per channel.
+// Channels 4-7 are channels 0-3 with the address bit set (extended address space), they need more than 4 channels.
+#ifndef IR_CHANNELS
+#define IR_CHANNELS              4
+#endif
+// Protocol modes handled by update(), samples of a disabled mode are dropped (0 = compiled out)
+#ifndef IR_STANDARD_RC
+#define IR_STANDARD_RC           1
+#endif
+#ifndef IR_PWM_RC
+#define IR_PWM_RC                1
+#endif
+// Number of IRSample slots in the event queue (power of 2, 2-128), further samples are dropped and counted
+#ifndef IR_QUEUE_SIZE
+#define IR_QUEUE_SIZE           16
+#endif
+// Coalescing: update() applies all queued samples first and calls the event handlers once per channel with the net
+// changes, instead of once per sample (0 = handlers per sample)
+#ifndef IR_COALESCE
+#define IR_COALESCE              0
+#endif
+// Failsafe: reset a subchannel's actual_step (and trigger its changed handler) if no frame of a mode the remote repeats
+// (standard rc / combo pwm, as PF receivers) refreshed it for its timeout, see PowerFunctionsIR::set_failsafe()
+// (0 = compiled out). With IR_PREFILTER repeated frames of these modes pass the pre-filter to refresh the timeouts.
+#ifndef IR_FAILSAFE
+#define IR_FAILSAFE              0
+#endif
+// Default timeout of all subchannels in ms, set by init()
+#ifndef IR_FAILSAFE_TIMEOUT_MS
+#define IR_FAILSAFE_TIMEOUT_MS 1200
+#endif
+// Timer wheel: tick (timeout resolution) in ms and number of slots (power of 2, 2-128)
+#ifndef IR_FAILSAFE_TICK_MS
+#define IR_FAILSAFE_TICK_MS     16
+#endif
+#ifndef IR_FAILSAFE_SLOTS
+#define IR_FAILSAFE_SLOTS       32
+#endif
+// Maximum number of output bindings, update() sets bound PowerFunctionsOutput ports from the subchannels' actual_step
+// without event handlers, see PowerFunctionsIR::bind() (0 = compiled out)
+#ifndef IR_BINDINGS
+#define IR_BINDINGS              0
+#endif
+// Largest steps of a subchannel covered by the bindings' value tables (1-127, one byte per step and subchannel),
+// subchannels with more steps are mapped with value()
+#ifndef IR_BINDING_MAX_STEPS
+#define IR_BINDING_MAX_STEPS    15
+#endif
+// Publish the channel states for readers in interrupt routines or other contexts, see PowerFunctionsIR::get_snapshot()
+// (0 = compiled out)
+#ifndef IR_SNAPSHOTS
+#define IR_SNAPSHOTS             0
+#endif
+// Number of event handlers with a context pointer that can be subscribed, see PowerFunctionsIR::subscribe()
+// (1-254, 0 = compiled out)
+#ifndef IR_SUBSCRIBERS
+#define IR_SUBSCRIBERS           0
+#endif
+// Pre-filter sampled IR events before they are enqueued (bad checksum, repeated, unsubscribed channel; with IR_FAILSAFE
+// repeated standard rc and combo pwm frames are kept)
+#ifndef IR_PREFILTER
+#define IR_PREFILTER             0
+#endif
+// Collect statistics of the IR pipeline, see PowerFunctionsIR::get_stats() (0 = compiled out)
+#ifndef IR_STATS
+#define IR_STATS                 0
+#endif
+// Record the intervals between IR edges for replay, see PowerFunctionsIR::read_capture() (0 = compiled out)
+#ifndef IR_CAPTURE
+#define IR_CAPTURE               0
+#endif
+// Size of the capture ring in bytes (power of 2, 16-32768, a frame takes about 21 bytes)
+#ifndef IR_CAPTURE_SIZE
+#define IR_CAPTURE_SIZE        512
+#endif
+// Deferred decoding: the ISR only records edge timestamps, bits are decoded in update() (0 = decode in the ISR)
+#ifndef IR_DEFERRED_DECODE
+#define IR_DEFERRED_DECODE       0
+#endif
+// Number of edge timestamps buffered for deferred decoding (power of 2, 2-128, a frame has 18 edges)
+#ifndef IR_EDGE_BUFFER_SIZE
+#define IR_EDGE_BUFFER_SIZE     64
+#endif
+
+/*
+    PowerFunctionsIRSender
+    Sending uses timer5 for the 38 kHz carrier, its output compare pin OC5A (46) is the IR LED pin.
+    After init_sender() pwm on the other timer5 pins (PF_OUT_A7) runs at 38 kHz with a duty cycle of value / 421.
+*/
+// IR LED pin (fixed, OC5A)
+#define IR_SEND_PIN             46
+// Number of commands waiting to be sent (power of 2, 2-128), each command is sent IR_SEND_REPEATS times
+#ifndef IR_SEND_QUEUE_SIZE
+#define IR_SEND_QUEUE_SIZE       8
+#endif
+#ifndef IR_SEND_REPEATS
+#define IR_SEND_REPEATS          5
+#endif
 
 /*
     PowerFunctionsOutput
@@ -33,6 +149,8 @@
 #define PF_OUT_A1  2,  3
 #define PF_OUT_A2  4,  5
 #define PF_OUT_A3  6,  7
+// Pin 9 (PF_OUT_A4) and pin 10 (PF_OUT_A5) are timer2's, with PF_OUT_SOFT_PWM their pwm runs at 3.9 kHz instead of
+// 490 Hz while a software pwm pin has a duty cycle between off and full (see SoftPWM.h)
 #define PF_OUT_A4  8,  9
 #define PF_OUT_A5 10, 11
 #define PF_OUT_A6 12, 13
@@ -42,3 +160,52 @@
 #define PF_OUT_D1 42, 43
 #define PF_OUT_D2 40, 41
 #define PF_OUT_D3 38, 39
+
+// Use software pwm (see SoftPWM.h) for pins without hardware pwm, e.g. PF_OUT_D* (0 = on/off as analogWrite())
+#ifndef PF_OUT_SOFT_PWM
+#define PF_OUT_SOFT_PWM          0
+#endif
+
+/*
+    SoftPWM
+*/
+// Duty cycle resolution (levels per pwm period, 2-255), pwm frequency is 3.9 kHz / SOFT_PWM_LEVELS
+#ifndef SOFT_PWM_LEVELS
+#define SOFT_PWM_LEVELS         16
+#endif
+// Maximum number of software pwm pins and of different ports these pins are on
+#ifndef SOFT_PWM_PINS
+#define SOFT_PWM_PINS            6
+#endif
+#ifndef SOFT_PWM_PORTS
+#define SOFT_PWM_PORTS           3
+#endif
+
+/*
+    PowerFunctionsRamp
+*/
+// Tick period of all ramps in milliseconds, accelerations are given per tick
+#ifndef RAMP_TICK_MS
+#define RAMP_TICK_MS            10
+#endif
+
+/*
+    OutputBank
+*/
+// Maximum number of PowerFunctionsOutput instances per OutputBank (1-127)
+#ifndef OUTPUT_BANK_SIZE
+#define OUTPUT_BANK_SIZE        10
+#endif
+
+/*
+    BrixxLink
+    Binary serial protocol for a host companion, see BrixxLink.h.
+*/
+// Bytes buffered for sending (power of 2, 16-128), frames that don't fit are dropped and counted
+#ifndef LINK_TX_BUFFER_SIZE
+#define LINK_TX_BUFFER_SIZE     64
+#endif
+// Maximum number of PowerFunctionsOutput ports the host can drive and watch
+#ifndef LINK_OUTPUTS
+#define LINK_OUTPUTS             8
+#endif
@@ -0,0 +1,42 @@
+#include "OutputBank.h"
+
+static_assert(OUTPUT_BANK_SIZE >= 1 && OUTPUT_BANK_SIZE <= 127, "OUTPUT_BANK_SIZE must be between 1 and 127");
+
+int8_t OutputBank::add(PowerFunctionsOutput &output)
+{
+    if (_count >= OUTPUT_BANK_SIZE) return -1;
+    uint8_t index = _count++;
+    _outputs[index] = &output;
+    _pending[index][0] = output.c1_get();
+    _pending[index][1] = output.c2_get();
+    insert_port({ digitalPinToTimer(output.c1_pin()), index, 0 });
+    insert_port({ digitalPinToTimer(output.c2_pin()), index, 1 });
+    return index;
+}
+
+void OutputBank::insert_port(Port port)
+{
+    // keep _ports sorted by timer (insertion sort, done once per pin)
+    uint8_t i = 2 * (_count - 1) + port.c2;
+    for (; i > 0 && _ports[i - 1].timer > port.timer; i--) _ports[i] = _ports[i - 1];
+    _ports[i] = port;
+}
+
+void OutputBank::commit( void )
+{
+    for (uint8_t i = 0; i < 2 * _count; i++) {
+        Port port = _ports[i];
+        PowerFunctionsOutput* output = _outputs[port.index];
+        uint8_t value = _pending[port.index][port.c2];
+        if ((port.c2 ? output->c2_get() : output->c1_get()) == value) {
+            _writes_skipped++;
+            continue;
+        }
+        if (port.c2) {
+            output->c2_set(value);
+        } else {
+            output->c1_set(value);
+        }
+        _writes_performed++;
+    }
+}
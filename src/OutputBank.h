@@ -0,0 +1,46 @@
+/*
+  OutputBank.h - Batched updates for a group of PowerFunctionsOutput ports.
+  Created by Heiko Finzel, 2017.
+
+  Values set on the bank are only recorded, commit() writes the ones that differ from the outputs' current values
+  (c1_get() / c2_get()). Outputs added to a bank must not be written directly, the next commit() overwrites such a
+  write with the bank's pending value.
+  Pins are written ordered by the hardware timer they share, so pins of one timer are written back to back (still
+  one write per pin, there is no batched timer register update).
+*/
+#pragma once
+#include "Arduino.h"
+#include "BrixxSettings.h"
+#include "PowerFunctionsOutput.h"
+
+class OutputBank
+{
+  public:
+    // add an output (up to OUTPUT_BANK_SIZE), returns its index in the bank or -1 if the bank is full
+    int8_t add( PowerFunctionsOutput &output );
+    uint8_t size( void ) const { return _count; }
+    // record pending values, written by commit()
+    void c1_set( uint8_t index, uint8_t value ) { if (index < _count) _pending[index][0] = value; }
+    void c2_set( uint8_t index, uint8_t value ) { if (index < _count) _pending[index][1] = value; }
+    void set( uint8_t index, uint8_t value_c1, uint8_t value_c2 ) { c1_set(index, value_c1); c2_set(index, value_c2); }
+    void off( uint8_t index ) { set(index, 0, 0); }
+    // write all pending values that changed
+    void commit( void );
+    // statistics of commit()
+    unsigned long writes_performed( void ) const { return _writes_performed; }
+    unsigned long writes_skipped( void ) const { return _writes_skipped; }
+  private:
+    // one pin of an output, sorted by timer (index fits OUTPUT_BANK_SIZE <= 127)
+    struct Port {
+        uint8_t timer;
+        uint8_t index: 7;
+        uint8_t c2: 1;
+    };
+    PowerFunctionsOutput* _outputs[OUTPUT_BANK_SIZE];
+    uint8_t _pending[OUTPUT_BANK_SIZE][2];
+    Port _ports[2 * OUTPUT_BANK_SIZE];
+    uint8_t _count = 0;
+    unsigned long _writes_performed = 0;
+    unsigned long _writes_skipped = 0;
+    void insert_port( Port port );
+};
@@ -8,107 +8,977 @@
  * Warranty for your LEGO Power Functions items may void using this project.
  */
 #include "PowerFunctionsIR.h"
+#if IR_BINDINGS
+#include "PowerFunctionsOutput.h"
+#endif
+
+#if IR_DEFERRED_DECODE && defined(TCNT0) && defined(TIFR0)
+// Timer0 overflow counter of the Arduino core (wiring.c), micros() is derived from it.
+extern "C" volatile unsigned long timer0_overflow_count;
+#endif
 
 namespace PowerFunctionsIR {
 
+#if IR_DEFERRED_DECODE
+static_assert(IR_EDGE_BUFFER_SIZE >= 2 && IR_EDGE_BUFFER_SIZE <= 128
+    && !(IR_EDGE_BUFFER_SIZE & (IR_EDGE_BUFFER_SIZE - 1)), "IR_EDGE_BUFFER_SIZE must be a power of 2 between 2 and 128");
+// Microseconds per timer0 tick (prescaler 64).
+#define CAPTURE_TICK_US (64 / clockCyclesPerMicrosecond())
+#endif
+#if IR_CAPTURE
+static_assert(IR_CAPTURE_SIZE >= 16 && IR_CAPTURE_SIZE <= 32768 && !(IR_CAPTURE_SIZE & (IR_CAPTURE_SIZE - 1)),
+    "IR_CAPTURE_SIZE must be a power of 2 between 16 and 32768");
+#endif
+#if IR_FAILSAFE
+static_assert(IR_FAILSAFE_SLOTS >= 2 && IR_FAILSAFE_SLOTS <= 128 && !(IR_FAILSAFE_SLOTS & (IR_FAILSAFE_SLOTS - 1)),
+    "IR_FAILSAFE_SLOTS must be a power of 2 between 2 and 128");
+static_assert(IR_FAILSAFE_TICK_MS >= 1
+    && (65535 + IR_FAILSAFE_TICK_MS - 1) / IR_FAILSAFE_TICK_MS < 256L * IR_FAILSAFE_SLOTS,
+    "IR_FAILSAFE_TICK_MS * IR_FAILSAFE_SLOTS is too short for timeouts up to 65535 ms");
+#endif
+#if IR_BINDINGS
+static_assert(IR_BINDINGS <= 64, "IR_BINDINGS must be 64 or less");
+static_assert(IR_BINDING_MAX_STEPS >= 1 && IR_BINDING_MAX_STEPS <= 127, "IR_BINDING_MAX_STEPS must be 1-127");
+#endif
+static_assert(IR_SUBSCRIBERS <= 254, "IR_SUBSCRIBERS must be 254 or less");
+static_assert(IR_CHANNELS >= 1 && IR_CHANNELS <= 8, "IR_CHANNELS must be between 1 and 8");
+static_assert(IR_STANDARD_RC || IR_PWM_RC, "IR_STANDARD_RC and IR_PWM_RC can't be both disabled");
+static_assert(NUMBER_RECEIVERS >= 1 && NUMBER_RECEIVERS <= IR_MAX_RECEIVERS,
+    "IR_RECEIVER_PINS must list 1 to IR_MAX_RECEIVERS pins");
+static_assert(IR_QUEUE_SIZE >= 2 && IR_QUEUE_SIZE <= 128 && !(IR_QUEUE_SIZE & (IR_QUEUE_SIZE - 1)),
+    "IR_QUEUE_SIZE must be a power of 2 between 2 and 128");
+
+/*
+    Receiver struct - decoder state of one IR receiver.
+*/
+struct Receiver {
+    // Sampling buffer.
+    IRSample value;
+    // Position of the bit to sample next.
+    int8_t position;
+    // Our interrupt address (derived from interrupt pin in init() and saved here).
+    uint8_t interrupt;
+    // Remember last sample interrupt time (with IR_DEFERRED_DECODE only kept for merging and IR_STATS).
+    unsigned long micros_last;
+#if IR_DEFERRED_DECODE
+    // Decoder state of decode_edges(), replaces swapping the interrupt routines.
+    uint16_t edge_last;
+    bool sampling;
+#endif
+#if NUMBER_RECEIVERS > 1
+    volatile ReceiverStats counters;
+#endif
+#if IR_ADAPTIVE_TIMING
+    // Means and thresholds in use and the means learned from the frame being sampled (committed if it is accepted).
+    BitTiming timing;
+    uint16_t low_learned;
+    uint16_t high_learned;
+    uint16_t start_stop_learned;
+#endif
+};
+
 /*
     Variables.
 */
-// Sampling buffer.
-IRSample sample_value;
-// Remember last sample interrupt time.
-volatile unsigned long sample_micros_last;
-// Position of the bit to sample next.
-volatile int8_t sample_position;
-// Our interrupt address (derived from interrupt pin in init() and saved here).
-uint8_t interrupt_address;
+// Interrupt pins and decoder states of the receivers.
+static const uint8_t receiver_pins[NUMBER_RECEIVERS] = { IR_RECEIVER_PINS };
+Receiver receivers[NUMBER_RECEIVERS];
+#if NUMBER_RECEIVERS > 1
+// Last frames enqueued (or dropped by the pre-filter) and their times, one per receiver, for merging.
+// More than one, as a receiver may decode a distorted frame in between the copies of the others.
+uint16_t merge_raw[NUMBER_RECEIVERS];
+unsigned long merge_micros[NUMBER_RECEIVERS];
+uint8_t merge_next;
+#endif
 // Saved states for all channels, see ChannelState struct in header.
 ChannelState channel_states[NUMBER_CHANNELS];
 // Event handlers - generic_handler is called for every type of event.                                                  
 EventHandler generic_handler;
-// These are called if the corresponding channel and subchannel is effected (channels = index 0-3).                     
+// These are called if the corresponding channel and subchannel is effected (channels = index 0-NUMBER_CHANNELS-1).
 EventHandler red_effected_handler[NUMBER_CHANNELS];
 EventHandler blue_effected_handler[NUMBER_CHANNELS];
-// These are called if the value associated with the channel and subchannel changes (channels = index 0-3).             
+// These are called if the value associated with the channel and subchannel changes (channels = index
+// 0-NUMBER_CHANNELS-1).
 EventHandler red_changed_handler[NUMBER_CHANNELS];
 EventHandler blue_changed_handler[NUMBER_CHANNELS];
-// The event queue's first and last element.
-Event* head;
-Event* tail;
+// Bit kind set = the channel has a handler of that kind in the arrays, noted by update().
+uint8_t handler_kinds[NUMBER_CHANNELS];
+#if IR_SUBSCRIBERS
+/*
+    Subscribed handlers, statically allocated. Lists per channel (index NUMBER_CHANNELS = ALL_CHANNELS) and event kind
+    linked by the subscribers' index + 1 (0 = end of list, a slot is free while its handler is 0), so no init() is
+    needed before subscribe(). Bit kind of subscriber_kinds set = list not empty.
+    Slots unsubscribed while handlers are called are unlinked but only marked dead, so the dispatch loop can still
+    follow their next index and subscribe() can't reuse them before all dispatching returned.
+*/
+struct Subscriber {
+    ContextHandler handler;
+    void *context;
+    uint8_t next;
+    bool dead;
+};
+Subscriber subscribers[IR_SUBSCRIBERS];
+uint8_t subscriber_heads[NUMBER_CHANNELS + 1][EVENT_KINDS];
+uint8_t subscriber_kinds[NUMBER_CHANNELS + 1];
+// Nesting depth of the subscriber dispatch loops and whether dead slots are waiting to be freed.
+uint8_t subscriber_dispatches;
+bool subscribers_dead;
+#endif
+// The event queue, free running read (head) and write (tail) positions and overflow counter.
+IRSample event_queue[IR_QUEUE_SIZE];
+volatile uint8_t queue_head;
+volatile uint8_t queue_tail;
+volatile uint16_t queue_overflows;
+#if IR_PREFILTER
+// Channels passed by the pre-filter, last signature passed per channel and drop counters.
+volatile uint8_t subscribed_channels = 0xFF;
+uint16_t prefilter_previous[NUMBER_CHANNELS];
+volatile PrefilterDrops prefilter_drops;
+#endif
 
-/*                                                                                                                      
-    Sampling IR events using an external interrupt pin.                                                                 
+#if IR_SNAPSHOTS
+/*
+    Published channel states, two copies of all of them and a latch counter. publish() makes the latch odd (readers
+    take copy 1), writes copy 0, makes it even (readers take copy 0) and writes copy 1. Readers take copy latch & 1 and
+    read again if the latch changed meanwhile, so an interrupt reading while update() publishes gets the copy not
+    being written and never reads again, and all channels of a copy are from the same moment.
 */
-void idle_isr( void ) {
-    unsigned long micros_now = micros();
-    uint16_t micros_diff = micros_now - sample_micros_last;
-    sample_micros_last = micros_now;
-    if (micros_diff < START_STOP_MAX && micros_diff > START_STOP_MIN) {
+ChannelSnapshot snapshots[2][NUMBER_CHANNELS];
+volatile uint8_t snapshot_latch;
+// Keep the compiler from moving the copies' accesses across the latch's (a single core needs no more than that).
+#define SNAPSHOT_BARRIER() __asm__ __volatile__("" ::: "memory")
+#endif
+
+#if IR_BINDINGS
+/*
+    Output bindings and the value tables of the subchannels (index channel << 1 | blue): value() of actual_step 0 to
+    steps (steps up to IR_BINDING_MAX_STEPS), rebuilt by set_steps(). Bit n of bound_changed = subchannel n changed
+    since the bindings were applied.
+*/
+struct Binding {
+    PowerFunctionsOutput* output;
+    uint8_t subchannel;
+    uint8_t flags;
+};
+Binding bindings[IR_BINDINGS];
+uint8_t binding_count;
+uint8_t step_values[NUMBER_CHANNELS * 2][IR_BINDING_MAX_STEPS + 1];
+uint16_t bound_changed;
+#endif
+
+#if IR_FAILSAFE
+/*
+    Failsafe timers, one per subchannel (index channel << 1 | blue), on a timer wheel of IR_FAILSAFE_SLOTS slots of
+    IR_FAILSAFE_TICK_MS. Each slot is a doubly linked list of timer indexes, so arming, refreshing and disarming a
+    timer is O(1) and a tick only visits the timers of one slot. Timeouts longer than one turn of the wheel wait for
+    their rounds.
+*/
+#define FAILSAFE_TIMERS          (NUMBER_CHANNELS * 2)
+#define FAILSAFE_NONE            0xFF
+struct FailsafeTimer {
+    // Timeout in ticks (0 = off).
+    uint16_t ticks;
+    // Slot the timer is linked into (FAILSAFE_NONE = disarmed), its neighbours there and the turns left.
+    uint8_t slot;
+    uint8_t prev;
+    uint8_t next;
+    uint8_t rounds;
+};
+FailsafeTimer failsafe_timers[FAILSAFE_TIMERS];
+// First timer of each slot, the slot of the current tick, its time and the number of timers armed.
+uint8_t failsafe_wheel[IR_FAILSAFE_SLOTS];
+uint8_t failsafe_tick;
+unsigned long failsafe_millis;
+uint8_t failsafe_armed;
+#endif
+
+#if IR_STATS
+/*
+    Statistics. The counters of the ISR (sampling and pre-filter) are free running, reset_stats() only remembers their
+    values (stats_base), so the ISR stays their only writer. update() counts in its own fields (loop_counters), the
+    queue high water mark is cleared with interrupts disabled. Time of the frame in each queue slot and of the last
+    dequeued frame.
+*/
+struct Counters {
+    uint16_t start_stops;
+    uint16_t restarts;
+    uint16_t timing_errors;
+    uint16_t frames;
+    uint16_t checksum_errors;
+    uint16_t redundant;
+};
+struct LoopCounters {
+    uint16_t checksum_errors;
+    uint16_t redundant;
+    uint16_t handler_calls;
+};
+volatile Counters stats_counters;
+Counters stats_base;
+LoopCounters loop_counters;
+volatile uint8_t stats_high_water;
+unsigned long stats_latency_min;
+unsigned long stats_latency_max;
+unsigned long stats_latency_sum;
+uint16_t stats_latency_count;
+volatile unsigned long queue_micros[IR_QUEUE_SIZE];
+unsigned long dequeued_micros;
+// Time of the edge completing the frame enqueued next.
+unsigned long frame_micros;
+#define IR_STAT_INC(counter) (stats_counters.counter++)
+#define IR_LOOP_STAT_INC(counter) (loop_counters.counter++)
+#else
+#define IR_STAT_INC(counter)
+#define IR_LOOP_STAT_INC(counter)
+#endif
+
+// 16 bit reads aren't atomic on AVR, read again until we got a value the ISR didn't change in between.
+static uint16_t read_counter(const volatile uint16_t &counter) {
+    uint16_t value;
+    do {
+        value = counter;
+    } while (value != counter);
+    return value;
+}
+
+#if IR_CAPTURE
+/*
+    Capture ring, free running read (head) and write (tail) positions in bytes. Written by the decoder steps (ISR or
+    update() with IR_DEFERRED_DECODE), read by read_capture(). capture_lost is set if an interval didn't fit.
+*/
+volatile uint8_t capture_buffer[IR_CAPTURE_SIZE];
+volatile uint16_t capture_head;
+volatile uint16_t capture_tail;
+bool capture_lost;
+
+// Append an interval, a CAPTURE_LOST marker is written first if intervals were dropped before.
+static void capture(uint16_t micros_diff) {
+    uint16_t tail = capture_tail;
+    uint16_t free = IR_CAPTURE_SIZE - (uint16_t)(tail - read_counter(capture_head));
+    uint16_t units = micros_diff >> 2;
+    if (units > (CAPTURE_LONG_GAP & 0x0FFF)) units = CAPTURE_LONG_GAP & 0x0FFF;
+    uint8_t needed = (units < CAPTURE_ESCAPE ? 1 : 2) + (capture_lost ? 2 : 0);
+    if (free < needed) {
+        capture_lost = true;
+        return;
+    }
+    if (capture_lost) {
+        capture_buffer[tail++ & (IR_CAPTURE_SIZE - 1)] = CAPTURE_LOST >> 8;
+        capture_buffer[tail++ & (IR_CAPTURE_SIZE - 1)] = CAPTURE_LOST & 0xFF;
+        capture_lost = false;
+    }
+    if (units < CAPTURE_ESCAPE) {
+        capture_buffer[tail++ & (IR_CAPTURE_SIZE - 1)] = units;
+    } else {
+        capture_buffer[tail++ & (IR_CAPTURE_SIZE - 1)] = CAPTURE_ESCAPE | units >> 8;
+        capture_buffer[tail++ & (IR_CAPTURE_SIZE - 1)] = units & 0xFF;
+    }
+    // Publish the interval only after all of its bytes were written.
+    capture_tail = tail;
+}
+#endif
+
+/*
+    Check if the sample is for a channel and protocol mode handled by this build (see IR_CHANNELS, IR_STANDARD_RC and
+    IR_PWM_RC), both checks are compiled out with the defaults.
+*/
+static inline bool handled_mode(const IRSample &sample) {
+#if IR_CHANNELS != 4 && IR_CHANNELS != 8
+    if (sample.get_channel() >= NUMBER_CHANNELS) return false;
+#endif
+#if !IR_STANDARD_RC
+    if (sample.standard_rc()) return false;
+#endif
+#if !IR_PWM_RC
+    // Only standard rc samples are left then.
+    if (!sample.standard_rc()) return false;
+#endif
+    (void)sample;
+    return true;
+}
+
+// get_red/blue_command() in one go for the samples passing handled_mode(), without checks for disabled modes.
+static inline void decode_commands(const IRSample &sample, uint8_t &red, uint8_t &blue) {
+#if IR_STANDARD_RC
+    // Standard rc, the only mode left without IR_PWM_RC.
+    if (!IR_PWM_RC || (!sample.escape && sample.mode == 1)) {
+        red = sample.data & 0x3;
+        blue = sample.data >> 2 & 0x3;
+        return;
+    }
+#endif
+#if IR_PWM_RC
+    if (sample.escape) {
+        red = IRSample::get_pwm_command(sample.data);
+        blue = IRSample::get_pwm_command(sample.nibble2);
+        return;
+    }
+    red = sample.get_mode_red_command();
+    blue = sample.get_mode_blue_command();
+#endif
+}
+
+#if IR_PREFILTER
+/*
+    Pre-filter, drops samples update() would discard anyway before they are enqueued.
+    Returns true if the sample should be enqueued.
+*/
+static inline bool prefilter(const IRSample &sample) {
+    if (!sample.checksum_ok()) {
+        prefilter_drops.checksum++;
+        IR_STAT_INC(checksum_errors);
+        return false;
+    }
+    uint8_t channel = sample.get_channel();
+    if (!(subscribed_channels & 1 << channel) || !handled_mode(sample)) {
+        prefilter_drops.unsubscribed++;
+        return false;
+    }
+    // Same redundancy check as in update(), see there.
+    if (prefilter_previous[channel] == sample.get_state_signature()) {
+#if IR_FAILSAFE
+        // Repeats of the modes the remote repeats keep the failsafe timers running, update() only refreshes them.
+        if (sample.escape || sample.mode == 1) return true;
+#endif
+        prefilter_drops.repeated++;
+        IR_STAT_INC(redundant);
+        return false;
+    }
+    prefilter_previous[channel] = sample.get_state_signature();
+    return true;
+}
+#endif
+
+/*
+    Bit timing thresholds of a receiver, fixed or learned (IR_ADAPTIVE_TIMING).
+*/
+#if IR_ADAPTIVE_TIMING
+#define RECEIVER_LOW_MIN(r)           (r).timing.low_min
+#define RECEIVER_HIGH_MIN(r)          (r).timing.high_min
+#define RECEIVER_START_STOP_MIN(r)    (r).timing.start_stop_min
+#define RECEIVER_START_STOP_MAX(r)    (r).timing.start_stop_max
+
+// Move mean 1/2^shift of the way to the interval (rounded, flooring would pull the mean down by 2^shift / 2).
+static inline uint16_t learn(uint16_t mean, uint16_t micros_diff, uint8_t shift) {
+    return mean + ((int16_t)(micros_diff - mean + (1 << (shift - 1))) >> shift);
+}
+
+// Keep a learned mean within 75-125% of its typical value.
+static inline uint16_t clamp_mean(uint16_t mean, uint16_t typical) {
+    if (mean < typical - (typical >> 2)) return typical - (typical >> 2);
+    if (mean > typical + (typical >> 2)) return typical + (typical >> 2);
+    return mean;
+}
+
+// Take over the means learned from an accepted frame and derive the thresholds (see BitTiming).
+static void commit_timing(Receiver &r) {
+    BitTiming &t = r.timing;
+    t.low = clamp_mean(learn(t.low, r.low_learned, 4), LOW_TYPICAL);
+    t.high = clamp_mean(learn(t.high, r.high_learned, 4), HIGH_TYPICAL);
+    t.start_stop = clamp_mean(learn(t.start_stop, r.start_stop_learned, 4), START_STOP_TYPICAL);
+    t.low_min = t.low >> 1;
+    t.high_min = (t.low + t.high) >> 1;
+    t.start_stop_min = (t.high + t.start_stop) >> 1;
+    t.start_stop_max = t.start_stop + (t.start_stop >> 2) + (t.start_stop >> 4);
+}
+
+static void reset_timing(Receiver &r) {
+    r.timing.low = r.low_learned = LOW_TYPICAL;
+    r.timing.high = r.high_learned = HIGH_TYPICAL;
+    r.timing.start_stop = r.start_stop_learned = START_STOP_TYPICAL;
+    commit_timing(r);
+}
+
+// Restart learning from the means in use on a start-stop-signal.
+static inline void start_learning(Receiver &r, uint16_t micros_diff) {
+    r.low_learned = r.timing.low;
+    r.high_learned = r.timing.high;
+    r.start_stop_learned = micros_diff;
+}
+#define LEARN_START_STOP(r, micros_diff) start_learning(r, micros_diff)
+#define LEARN_HIGH(r, micros_diff)       (r).high_learned = learn((r).high_learned, micros_diff, 2)
+#define LEARN_LOW(r, micros_diff)        (r).low_learned = learn((r).low_learned, micros_diff, 2)
+#else
+#define RECEIVER_LOW_MIN(r)           LOW_MIN
+#define RECEIVER_HIGH_MIN(r)          HIGH_MIN
+#define RECEIVER_START_STOP_MIN(r)    START_STOP_MIN
+#define RECEIVER_START_STOP_MAX(r)    START_STOP_MAX
+#define LEARN_START_STOP(r, micros_diff)
+#define LEARN_HIGH(r, micros_diff)
+#define LEARN_LOW(r, micros_diff)
+#endif
+
+/*
+    Decoder steps, shared by the interrupt routines and the deferred decoder (see IR_DEFERRED_DECODE).
+*/
+// Hand a frame completed at micros (µs) on to the queue through the pre-filter, false if the queue was full.
+static inline bool submit_frame(const IRSample &sample, unsigned long micros) {
+#if IR_STATS
+    frame_micros = micros;
+#else
+    (void)micros;
+#endif
+#if IR_PREFILTER
+    if (!prefilter(sample)) return true;
+#endif
+    return enqueue(sample);
+}
+
+// Hand a sampled frame on to the queue, unless another receiver decoded it already.
+static inline void submit(Receiver &r) {
+#if NUMBER_RECEIVERS > 1
+    r.counters.frames++;
+    for (uint8_t i = 0; i < NUMBER_RECEIVERS; i++) {
+        if (r.value.raw == merge_raw[i] && r.micros_last - merge_micros[i] < IR_MERGE_WINDOW_US) {
+            r.counters.merged++;
+            return;
+        }
+    }
+    merge_raw[merge_next] = r.value.raw;
+    merge_micros[merge_next] = r.micros_last;
+    merge_next = merge_next + 1 < NUMBER_RECEIVERS ? merge_next + 1 : 0;
+#endif
+    submit_frame(r.value, r.micros_last);
+}
+
+// Returns true if a start-stop-signal was detected and sampling starts.
+static inline bool idle_step(Receiver &r, uint16_t micros_diff) {
+#if IR_CAPTURE
+    if (&r == receivers) capture(micros_diff);
+#endif
+    if (micros_diff < RECEIVER_START_STOP_MAX(r) && micros_diff > RECEIVER_START_STOP_MIN(r)) {
         // Start sampling on start-stop-signal.
-        sample_value.raw = 0;
-        sample_position = 15;
-        attachInterrupt(interrupt_address, sample_isr, FALLING);
+        IR_STAT_INC(start_stops);
+        LEARN_START_STOP(r, micros_diff);
+        r.value.raw = 0;
+        r.position = 15;
+        return true;
     }
+    return false;
 }
 
-void sample_isr( void ) {
-    unsigned long micros_now = micros();
-    uint16_t micros_diff = micros_now - sample_micros_last;
-    sample_micros_last = micros_now;
-    if (micros_diff < START_STOP_MAX && micros_diff > LOW_MIN) {
-        if (micros_diff > START_STOP_MIN) {
+// Returns false if sampling is finished, either 16 bit were sampled and enqueued or there was a signal error.
+static inline bool sample_step(Receiver &r, uint16_t micros_diff) {
+#if IR_CAPTURE
+    if (&r == receivers) capture(micros_diff);
+#endif
+    if (micros_diff < RECEIVER_START_STOP_MAX(r) && micros_diff > RECEIVER_LOW_MIN(r)) {
+        if (micros_diff > RECEIVER_START_STOP_MIN(r)) {
             // Restart sampling on early start-stop-signal (most certainly a new, interfering signal).
-            sample_value.raw = 0;
-            sample_position = 15;
-        } else if (micros_diff > HIGH_MIN) {
+            IR_STAT_INC(restarts);
+            LEARN_START_STOP(r, micros_diff);
+            r.value.raw = 0;
+            r.position = 15;
+        } else if (micros_diff > RECEIVER_HIGH_MIN(r)) {
             // Sampled a high bit.
-            sample_value.raw |= 1 << sample_position;
-            sample_position -= 1;
+            r.value.raw |= 1 << r.position;
+            r.position -= 1;
+            LEARN_HIGH(r, micros_diff);
         } else {
-            // Sampled a low bit (add 0 << sample_position => no change).
-            sample_position -= 1;
+            // Sampled a low bit (add 0 << position => no change).
+            r.position -= 1;
+            LEARN_LOW(r, micros_diff);
         }
-        if (sample_position < 0) {
+        if (r.position < 0) {
             // Successfully sampled 16 bit -> enqueue event.
-            enqueue(sample_value);
-            attachInterrupt(interrupt_address, idle_isr, FALLING);
+            IR_STAT_INC(frames);
+#if IR_ADAPTIVE_TIMING
+            if (r.value.checksum_ok()) commit_timing(r);
+#endif
+            submit(r);
+            return false;
         }
-    } else {
-        // Reset on signal error.
-        attachInterrupt(interrupt_address, idle_isr, FALLING);
+        return true;
     }
+    // Reset on signal error.
+    IR_STAT_INC(timing_errors);
+#if NUMBER_RECEIVERS > 1
+    r.counters.errors++;
+#endif
+    return false;
 }
 
-/*                                                                                                                      
-    Event processing.                                                                                                   
+/*
+    Sampling IR events using an external interrupt pin.
+    One pair of interrupt routines per receiver (R = index in IR_RECEIVER_PINS), the first receiver's are the public
+    idle_isr() and sample_isr().
 */
-void enqueue(IRSample &sample) {
-    Event* p_event = (Event*)malloc(sizeof(Event));
-    p_event->ir_event = sample;
-    p_event->next = 0;
-    if (tail) {
-        tail->next = p_event;
-        tail = p_event;
-    } else {
-        head = tail = p_event;
+// Interval since the receiver's previous edge.
+static inline uint16_t edge_interval(Receiver &r) {
+    unsigned long micros_now = micros();
+    uint16_t micros_diff = micros_now - r.micros_last;
+    r.micros_last = micros_now;
+    return micros_diff;
+}
+
+template<uint8_t R> void receiver_sample_isr( void );
+
+template<uint8_t R> void receiver_idle_isr( void ) {
+    Receiver &r = receivers[R];
+    if (idle_step(r, edge_interval(r))) attachInterrupt(r.interrupt, R ? receiver_sample_isr<R> : sample_isr, FALLING);
+}
+
+template<uint8_t R> void receiver_sample_isr( void ) {
+    Receiver &r = receivers[R];
+    if (!sample_step(r, edge_interval(r))) attachInterrupt(r.interrupt, R ? receiver_idle_isr<R> : idle_isr, FALLING);
+}
+
+void idle_isr( void ) {
+    receiver_idle_isr<0>();
+}
+
+void sample_isr( void ) {
+    receiver_sample_isr<0>();
+}
+
+#if IR_DEFERRED_DECODE
+/*
+    Deferred decoding.
+    capture_isr() only stores a 16 bit timestamp in timer0 ticks (4 µs on 16 MHz boards), the same counter micros()
+    is derived from, so the intervals decoded in update() are identical to the ones the ISRs above compute.
+*/
+// Edge timestamps (and their receivers), free running read (head) and write (tail) positions and overflow counter.
+volatile uint16_t edge_buffer[IR_EDGE_BUFFER_SIZE];
+#if NUMBER_RECEIVERS > 1
+volatile uint8_t edge_receiver[IR_EDGE_BUFFER_SIZE];
+#endif
+volatile uint8_t edge_head;
+volatile uint8_t edge_tail;
+volatile uint16_t edge_overflows;
+
+// Read timer0 like micros() does, but without locking interrupts (we are in interrupt context) and the 32 bit math.
+static inline uint16_t capture_timestamp( void ) {
+#if defined(TCNT0) && defined(TIFR0)
+    uint8_t ticks = TCNT0;
+    uint16_t overflows = timer0_overflow_count;
+    if ((TIFR0 & _BV(TOV0)) && ticks < 255) overflows++;
+    return overflows << 8 | ticks;
+#else
+    return micros() / CAPTURE_TICK_US;
+#endif
+}
+
+template<uint8_t R> void receiver_capture_isr( void ) {
+    uint16_t timestamp = capture_timestamp();
+    uint8_t tail = edge_tail;
+    if ((uint8_t)(tail - edge_head) >= IR_EDGE_BUFFER_SIZE) {
+        edge_overflows++;
+        return;
     }
+    edge_buffer[tail & (IR_EDGE_BUFFER_SIZE - 1)] = timestamp;
+#if NUMBER_RECEIVERS > 1
+    edge_receiver[tail & (IR_EDGE_BUFFER_SIZE - 1)] = R;
+#endif
+    edge_tail = tail + 1;
+}
+
+void capture_isr( void ) {
+    receiver_capture_isr<0>();
 }
 
-Event* dequeue( void ) {
-    Event* p_event = head;
+void decode_edges( void ) {
+    uint8_t head = edge_head;
+    while (head != edge_tail) {
+        uint16_t timestamp = edge_buffer[head & (IR_EDGE_BUFFER_SIZE - 1)];
+#if NUMBER_RECEIVERS > 1
+        Receiver &r = receivers[edge_receiver[head & (IR_EDGE_BUFFER_SIZE - 1)]];
+#else
+        Receiver &r = receivers[0];
+#endif
+        edge_head = ++head;
+        // Truncated to 16 bit just like micros_diff in the ISRs.
+        uint16_t micros_diff = (uint16_t)(timestamp - r.edge_last) * CAPTURE_TICK_US;
+        r.edge_last = timestamp;
+#if IR_STATS || NUMBER_RECEIVERS > 1
+        // Time of the edge, to measure latency and merge frames like sample_isr() does.
+        unsigned long micros_now = micros();
+        r.micros_last = micros_now - (uint16_t)(micros_now / CAPTURE_TICK_US - timestamp) * CAPTURE_TICK_US;
+#endif
+        r.sampling = r.sampling ? sample_step(r, micros_diff) : idle_step(r, micros_diff);
+    }
+}
+#endif
+
+/*
+    Attach the interrupt routines of receiver R and all receivers before it.
+*/
+template<uint8_t R> static void attach_receivers( void ) {
+    if (R) attach_receivers<R ? R - 1 : 0>();
+    Receiver &r = receivers[R];
+    // A pin without an external interrupt can't sample, its receiver stays silent.
+    if (digitalPinToInterrupt(receiver_pins[R]) == NOT_AN_INTERRUPT) return;
+    pinMode(receiver_pins[R], INPUT);
+    r.interrupt = digitalPinToInterrupt(receiver_pins[R]);
+#if NUMBER_RECEIVERS > 1
+    r.counters.frames = r.counters.merged = r.counters.errors = 0;
+#endif
+#if IR_ADAPTIVE_TIMING
+    reset_timing(r);
+#endif
+#if IR_DEFERRED_DECODE
+    r.sampling = false;
+    attachInterrupt(r.interrupt, R ? receiver_capture_isr<R> : capture_isr, FALLING);
+#else
+    attachInterrupt(r.interrupt, R ? receiver_idle_isr<R> : idle_isr, FALLING);
+#endif
+}
+
+/*                                                                                                                      
+    Event processing.                                                                                                   
+*/
+bool enqueue(const IRSample &sample) {
+    uint8_t tail = queue_tail;
+    if ((uint8_t)(tail - queue_head) >= IR_QUEUE_SIZE) {
+        queue_overflows++;
+        return false;
+    }
     /*
-        If we remove the last element of the queue this is a critical action.
-        To ensure queue doesn't get corrupted if interrupt adds an element at the
-        wrong moment we lock interrupts until queue is in a consistent state again.
+        raw is volatile, so the slot is written before the new tail is published and the consumer never sees a
+        half written sample.
     */
-    if (head == tail) noInterrupts();
-    head = head->next;
-    if (!head) tail = 0;
-    // Unlock ...
-    interrupts();
-    return p_event;
+    event_queue[tail & (IR_QUEUE_SIZE - 1)].raw = sample.raw;
+#if IR_STATS
+    // The edge that completed the sample.
+    queue_micros[tail & (IR_QUEUE_SIZE - 1)] = frame_micros;
+    uint8_t depth = tail + 1 - queue_head;
+    if (depth > stats_high_water) stats_high_water = depth;
+#endif
+    queue_tail = tail + 1;
+    return true;
+}
+
+bool dequeue(IRSample &sample) {
+    uint8_t head = queue_head;
+    if (head == queue_tail) return false;
+    sample.raw = event_queue[head & (IR_QUEUE_SIZE - 1)].raw;
+    sample.handled = false;
+#if IR_STATS
+    dequeued_micros = queue_micros[head & (IR_QUEUE_SIZE - 1)];
+#endif
+    // Release the slot only after it was read.
+    queue_head = head + 1;
+    return true;
+}
+
+bool submit(const IRSample &sample) {
+    // micros() locks interrupts itself, only the latency statistics need it.
+    unsigned long now = IR_STATS ? micros() : 0;
+    uint8_t sreg = SREG;
+    cli();
+    bool queued = submit_frame(sample, now);
+    SREG = sreg;
+    return queued;
+}
+
+uint16_t get_queue_overflows( void ) {
+    return read_counter(queue_overflows);
+}
+
+#if IR_DEFERRED_DECODE
+uint16_t get_edge_overflows( void ) {
+    return read_counter(edge_overflows);
+}
+#endif
+
+#if IR_CAPTURE
+uint16_t read_capture(uint8_t *buffer, uint16_t size) {
+    uint16_t head = capture_head;
+    uint16_t tail = read_counter(capture_tail);
+    uint16_t count = 0;
+    while (head != tail && count < size) buffer[count++] = capture_buffer[head++ & (IR_CAPTURE_SIZE - 1)];
+    // Release the bytes only after they were read.
+    capture_head = head;
+    return count;
+}
+
+void dump_capture(Print &out) {
+    uint8_t buffer[32];
+    uint16_t count;
+    while ((count = read_capture(buffer, sizeof(buffer)))) out.write(buffer, count);
+}
+#endif
+
+#if IR_STATS
+Stats get_stats( void ) {
+    Stats stats;
+    stats.start_stops = read_counter(stats_counters.start_stops) - stats_base.start_stops;
+    stats.restarts = read_counter(stats_counters.restarts) - stats_base.restarts;
+    stats.timing_errors = read_counter(stats_counters.timing_errors) - stats_base.timing_errors;
+    stats.frames = read_counter(stats_counters.frames) - stats_base.frames;
+    stats.checksum_errors = read_counter(stats_counters.checksum_errors) - stats_base.checksum_errors
+        + loop_counters.checksum_errors;
+    stats.redundant = read_counter(stats_counters.redundant) - stats_base.redundant + loop_counters.redundant;
+    stats.handler_calls = loop_counters.handler_calls;
+    stats.queue_high_water = stats_high_water;
+    stats.latency_min = stats_latency_count ? stats_latency_min : 0;
+    stats.latency_max = stats_latency_max;
+    stats.latency_mean = stats_latency_count ? stats_latency_sum / stats_latency_count : 0;
+    return stats;
+}
+
+void reset_stats( void ) {
+    stats_base.start_stops = read_counter(stats_counters.start_stops);
+    stats_base.restarts = read_counter(stats_counters.restarts);
+    stats_base.timing_errors = read_counter(stats_counters.timing_errors);
+    stats_base.frames = read_counter(stats_counters.frames);
+    stats_base.checksum_errors = read_counter(stats_counters.checksum_errors);
+    stats_base.redundant = read_counter(stats_counters.redundant);
+    loop_counters.checksum_errors = loop_counters.redundant = loop_counters.handler_calls = 0;
+    uint8_t sreg = SREG;
+    cli();
+    stats_high_water = 0;
+    SREG = sreg;
+    stats_latency_min = stats_latency_max = stats_latency_sum = 0;
+    stats_latency_count = 0;
+}
+
+// Account the latency of a sample whose frame ended at ended_micros, called when it is dispatched.
+static void stats_latency(unsigned long ended_micros) {
+    unsigned long latency = micros() - ended_micros;
+    if (!stats_latency_count || latency < stats_latency_min) stats_latency_min = latency;
+    if (latency > stats_latency_max) stats_latency_max = latency;
+    // Restart the mean before the sum can overflow.
+    if (stats_latency_count == 0xFFFF || stats_latency_sum > 0x7FFFFFFFUL) {
+        stats_latency_sum = stats_latency_count = 0;
+    }
+    stats_latency_sum += latency;
+    stats_latency_count++;
+}
+#endif
+
+#if NUMBER_RECEIVERS > 1
+ReceiverStats get_receiver_stats(uint8_t receiver) {
+    ReceiverStats stats = { 0, 0, 0 };
+    if (receiver >= NUMBER_RECEIVERS) return stats;
+    stats.frames = read_counter(receivers[receiver].counters.frames);
+    stats.merged = read_counter(receivers[receiver].counters.merged);
+    stats.errors = read_counter(receivers[receiver].counters.errors);
+    return stats;
+}
+#endif
+
+#if IR_ADAPTIVE_TIMING
+BitTiming get_bit_timing(uint8_t receiver) {
+    BitTiming timing = { 0, 0, 0, 0, 0, 0, 0 };
+    if (receiver >= NUMBER_RECEIVERS) return timing;
+    // Copy all fields of one commit.
+    uint8_t sreg = SREG;
+    cli();
+    timing = receivers[receiver].timing;
+    SREG = sreg;
+    return timing;
+}
+#endif
+
+#if IR_PREFILTER
+void set_subscribed_channels(uint8_t channel_mask) {
+    subscribed_channels = channel_mask;
+}
+
+PrefilterDrops get_prefilter_drops( void ) {
+    PrefilterDrops drops;
+    drops.checksum = read_counter(prefilter_drops.checksum);
+    drops.repeated = read_counter(prefilter_drops.repeated);
+    drops.unsubscribed = read_counter(prefilter_drops.unsubscribed);
+    return drops;
+}
+#endif
+
+/*
+    Channel state transitions.
+    Each command code of get_red/blue_command() maps to a transition of the subchannel's actual_step, one row for
+    normal and one for alternative mode. A transition is a set of the STEP_ flags below, applied in this order.
+    New command types are added as new command indexes and rows here.
+*/
+#define STEP_KEEP                 0x0001    // start from actual_step (else from 0)
+#define STEP_SET_MAX              0x0002    // start from +steps
+#define STEP_SET_MIN              0x0004    // start from -steps
+#define STEP_ABSOLUTE             0x0008    // pwm step of the command (1-7 forward, 9-15 backward) scaled to steps
+#define STEP_NEGATE               0x0010    // reverse the direction
+#define STEP_TOGGLE_MAX           0x0020    // +steps <-> 0
+#define STEP_TOGGLE_MIN           0x0040    // -steps <-> 0
+#define STEP_TOGGLE_FULL          0x0080    // -steps if forward, else +steps
+#define STEP_INCREASE             0x0100    // +1 if below +steps
+#define STEP_DECREASE             0x0200    // -1 if above -steps (0 in alternative mode)
+#define STEP_CLEAR_FORWARD        0x0400    // clear bit switch FORWARD (0x01)
+#define STEP_CLEAR_BACKWARD       0x0800    // clear bit switch BACKWARD (0x02)
+#define STEP_SET_FORWARD          0x1000    // set bit switch FORWARD (0x01)
+#define STEP_SET_BACKWARD         0x2000    // set bit switch BACKWARD (0x02)
+#define STEP_TOGGLE_FORWARD       0x4000    // toggle bit switch FORWARD (0x01)
+#define STEP_TOGGLE_BACKWARD      0x8000    // toggle bit switch BACKWARD (0x02)
+/*
+    Standard rc commands 0-3, pwm commands 0x13-0xF3 (data << 4 | 0x3) and RESET_VALUE, clear/set/toggle/increment/
+    decrement commands 0x0C-0xFC (data << 4 | 0xC) with INCREASE_VALUE and DECREASE_VALUE, and NO_COMMAND. The
+    index of a command is the one of the frame data it's decoded from.
+*/
+#define COMMAND_INDEXES             37
+
+static constexpr uint8_t command_index(uint8_t command) {
+    return command == NO_COMMAND ? COMMAND_INDEXES - 1 : command < 0x04 ? command :
+        (command & 0x0F) == 0x0C || command == INCREASE_VALUE || command == DECREASE_VALUE ? 20 + (command >> 4) :
+        4 + (command >> 4);
+}
+
+static constexpr uint16_t transition(uint8_t command, bool alternative) {
+    return command == STOP ? (alternative ? STEP_KEEP : 0) :
+        command == RESET_VALUE ? 0 :
+        command == FORWARD ? (alternative ? STEP_KEEP | STEP_TOGGLE_FORWARD : STEP_SET_MAX) :
+        command == BACKWARD ? (alternative ? STEP_KEEP | STEP_TOGGLE_BACKWARD : STEP_SET_MIN) :
+        command == INCREASE_VALUE || command == INCREASE_NUMERICAL ? STEP_KEEP | STEP_INCREASE :
+        command == DECREASE_VALUE || command == DECREASE_NUMERICAL ? STEP_KEEP | STEP_DECREASE :
+        // Clear/set/toggle mode, in alternative mode C1 and C2 are the bit switches.
+        command == TOGGLE_FULL_FORWARD ? (alternative ? STEP_KEEP | STEP_TOGGLE_FORWARD : STEP_KEEP | STEP_TOGGLE_MAX) :
+        command == TOGGLE_FULL_BACKWARD ?
+            (alternative ? STEP_KEEP | STEP_TOGGLE_BACKWARD : STEP_KEEP | STEP_TOGGLE_MIN) :
+        command == TOGGLE_DIRECTION ? (alternative ? STEP_KEEP : STEP_KEEP | STEP_NEGATE) :
+        command == TOGGLE_FULL_DIRECTION ?
+            (alternative ? STEP_KEEP | STEP_TOGGLE_FORWARD | STEP_TOGGLE_BACKWARD : STEP_KEEP | STEP_TOGGLE_FULL) :
+        command == FULL_FORWARD ? STEP_SET_MAX :
+        command == FULL_BACKWARD ? (alternative ? 0 : STEP_SET_MIN) :
+        command == CLEAR_C1 ? (alternative ? STEP_KEEP | STEP_CLEAR_FORWARD : 0) :
+        command == SET_C1 ? (alternative ? STEP_KEEP | STEP_SET_FORWARD : STEP_SET_MAX) :
+        command == TOGGLE_C1 ? (alternative ? STEP_KEEP | STEP_TOGGLE_FORWARD : STEP_KEEP | STEP_TOGGLE_MAX) :
+        command == CLEAR_C2 ? (alternative ? STEP_KEEP | STEP_CLEAR_BACKWARD : 0) :
+        command == SET_C2 ? (alternative ? STEP_KEEP | STEP_SET_BACKWARD : STEP_SET_MIN) :
+        command == TOGGLE_C2 ? (alternative ? STEP_KEEP | STEP_TOGGLE_BACKWARD : STEP_KEEP | STEP_TOGGLE_MIN) :
+        // Pwm mode, the remaining pwm commands are the forward and backward steps.
+        command != NO_COMMAND && (command & 0x0F) == 0x03 ? STEP_ABSOLUTE :
+        STEP_KEEP;
+}
+
+// One table row, ordered by command_index().
+#define TRANSITION_ROW(alternative) { \
+    transition(0x00, alternative), transition(0x01, alternative), transition(0x02, alternative), \
+    transition(0x03, alternative), transition(0x00, alternative), transition(0x13, alternative), \
+    transition(0x23, alternative), transition(0x33, alternative), transition(0x43, alternative), \
+    transition(0x53, alternative), transition(0x63, alternative), transition(0x73, alternative), \
+    transition(0x80, alternative), transition(0x93, alternative), transition(0xA3, alternative), \
+    transition(0xB3, alternative), transition(0xC3, alternative), transition(0xD3, alternative), \
+    transition(0xE3, alternative), transition(0xF3, alternative), transition(0x0C, alternative), \
+    transition(0x1C, alternative), transition(0x2C, alternative), transition(0x3C, alternative), \
+    transition(0x40, alternative), transition(0x50, alternative), transition(0x6C, alternative), \
+    transition(0x7C, alternative), transition(0x8C, alternative), transition(0x9C, alternative), \
+    transition(0xAC, alternative), transition(0xBC, alternative), transition(0xCC, alternative), \
+    transition(0xDC, alternative), transition(0xEC, alternative), transition(0xFC, alternative), \
+    transition(NO_COMMAND, alternative) }
+
+static const uint16_t transitions[2][COMMAND_INDEXES] PROGMEM = { TRANSITION_ROW(false), TRANSITION_ROW(true) };
+
+static_assert(command_index(NO_COMMAND) == COMMAND_INDEXES - 1 && command_index(0xFC) == COMMAND_INDEXES - 2
+    && command_index(0xF3) == 19 && command_index(RESET_VALUE) == 12 && command_index(INCREASE_VALUE) == 24,
+    "TRANSITION_ROW doesn't match command_index()");
+
+static inline void apply_transition(uint8_t command, SubchannelState &state) {
+    uint16_t t = pgm_read_word(&transitions[state.alternative][command_index(command)]);
+    int8_t steps = state.steps;
+    int8_t step = t & STEP_KEEP ? state.actual_step : 0;
+    if (t & STEP_SET_MAX) step = steps;
+    if (t & STEP_SET_MIN) step = -steps;
+    // Flags of the modes not used by LEGO remote controls.
+    if (t & (STEP_ABSOLUTE | STEP_NEGATE | STEP_TOGGLE_MAX | STEP_TOGGLE_MIN | STEP_TOGGLE_FULL)) {
+        if (t & STEP_ABSOLUTE) {
+            // Pwm steps 1-7 forward, 9-15 = backward 7-1, rounded to the subchannel's steps (x * 1171 >> 13 = x / 7,
+            // exact for the range used here, AVR has no division instruction).
+            uint8_t pwm = command >> 4 < 8 ? command >> 4 : 16 - (command >> 4);
+            uint8_t scaled = steps == 7 ? pwm : (uint32_t)(pwm * steps + 3) * 1171 >> 13;
+            step = command >> 4 < 8 ? scaled : state.alternative ? 0 : -scaled;
+        }
+        if (t & STEP_NEGATE) step = -step;
+        if (t & STEP_TOGGLE_MAX) step = step == steps ? 0 : steps;
+        if (t & STEP_TOGGLE_MIN) step = step == -steps ? 0 : -steps;
+        if (t & STEP_TOGGLE_FULL) step = step > 0 ? -steps : steps;
+    }
+    if (t & STEP_INCREASE && step < steps) step++;
+    if (t & STEP_DECREASE && step > (state.alternative ? 0 : -steps)) step--;
+    if (t & (STEP_CLEAR_FORWARD | STEP_CLEAR_BACKWARD | STEP_SET_FORWARD | STEP_SET_BACKWARD)) {
+        step = (step & ~(t >> 10 & 0x03)) | (t >> 12 & 0x03);
+    }
+    state.actual_step = step ^ (t >> 14 & 0x03);
+}
+
+#if IR_SNAPSHOTS
+// Publish the state of channel changed at time (µs).
+static void publish(uint8_t channel, unsigned long time) {
+    uint16_t sequence = snapshots[0][channel].sequence + 1;
+    snapshot_latch++;
+    SNAPSHOT_BARRIER();
+    for (uint8_t copy = 0; copy < 2; copy++) {
+        ChannelSnapshot &snapshot = snapshots[copy][channel];
+        snapshot.state = channel_states[channel];
+        snapshot.sequence = sequence;
+        snapshot.micros = time;
+        SNAPSHOT_BARRIER();
+        if (!copy) snapshot_latch++;
+        SNAPSHOT_BARRIER();
+    }
+}
+#endif
+
+#if IR_BINDINGS
+/*
+    Output bindings.
+*/
+// Fill the value tables of channel, the only divisions left (value() takes two 32 bit ones per call).
+static void build_step_values(uint8_t channel) {
+    for (uint8_t index = channel << 1; index <= (channel << 1 | 1); index++) {
+        const SubchannelState &state = index & 1 ? channel_states[channel].blue : channel_states[channel].red;
+        if (state.steps > IR_BINDING_MAX_STEPS) continue;
+        for (uint8_t step = 0; step <= state.steps; step++) step_values[index][step] = step * 255U / state.steps;
+    }
+}
+
+// value() of subchannel index from its table (actual_step beyond steps counts as steps).
+static inline int16_t step_value(uint8_t index, const SubchannelState &state) {
+    if (state.steps > IR_BINDING_MAX_STEPS) return state.value();
+    int8_t step = state.actual_step;
+    uint8_t magnitude = step < 0 ? -step : step;
+    if (magnitude > state.steps) magnitude = state.steps;
+    if (step >= 0) return step_values[index][magnitude];
+    // map() rounds negative values down in normal mode: -ceil(x) = -(255 - floor((steps - magnitude) * 255 / steps)).
+    return state.alternative ? -step_values[index][magnitude] : step_values[index][state.steps - magnitude] - 255;
 }
 
+// Set the outputs bound to the subchannels in bound_changed.
+static void apply_bindings( void ) {
+    for (uint8_t i = 0; i < binding_count; i++) {
+        Binding &binding = bindings[i];
+        if (!(bound_changed & 1U << binding.subchannel)) continue;
+        uint8_t channel = binding.subchannel >> 1;
+        const SubchannelState &state = binding.subchannel & 1 ? channel_states[channel].blue :
+            channel_states[channel].red;
+        uint8_t c1, c2;
+        if (state.alternative && binding.flags & BIND_SWITCHES) {
+            c1 = state.bit_switches() & FORWARD ? 255 : 0;
+            c2 = state.bit_switches() & BACKWARD ? 255 : 0;
+        } else {
+            int16_t value = step_value(binding.subchannel, state);
+            c1 = value > 0 ? value : 0;
+            c2 = value < 0 ? -value : 0;
+        }
+        if (binding.flags & BIND_REVERSE) {
+            uint8_t c = c1;
+            c1 = c2;
+            c2 = c;
+        }
+        if (binding.flags & BIND_INVERT) {
+            c1 = 255 - c1;
+            c2 = 255 - c2;
+        }
+        binding.output->set(c1, c2);
+    }
+    bound_changed = 0;
+}
+#endif
+
+#if IR_FAILSAFE
+// Timeout in ticks, the tick in progress doesn't count (never expires before timeout_ms). Computed in 32 bits, the sum
+// overflows an AVR int for timeouts near 65535 ms.
+static inline uint16_t failsafe_ticks(uint16_t timeout_ms) {
+    if (!timeout_ms) return 0;
+    uint32_t ticks = ((uint32_t)timeout_ms + IR_FAILSAFE_TICK_MS - 1) / IR_FAILSAFE_TICK_MS + 1;
+    return ticks > 0xFFFF ? 0xFFFF : ticks;
+}
+#endif
+
 /*
     User interface functions.
 */
@@ -117,104 +987,405 @@ void init( void ) {
         channel_states[i].red.steps = DEFAULT_STEPS;
         channel_states[i].blue.steps = DEFAULT_STEPS;
     }
-    pinMode(IR_SAMPLE_INTERRUPT_PIN, INPUT);
-    interrupt_address = digitalPinToInterrupt(IR_SAMPLE_INTERRUPT_PIN);
-    attachInterrupt(interrupt_address, idle_isr, FALLING);
+    queue_head = queue_tail;
+    queue_overflows = 0;
+#if IR_PREFILTER
+    prefilter_drops.checksum = prefilter_drops.repeated = prefilter_drops.unsubscribed = 0;
+#endif
+#if IR_STATS
+    reset_stats();
+#endif
+#if IR_CAPTURE
+    capture_head = capture_tail;
+    capture_lost = false;
+#endif
+#if IR_DEFERRED_DECODE
+    edge_head = edge_tail;
+    edge_overflows = 0;
+#endif
+#if IR_BINDINGS
+    for (uint8_t i = 0; i < NUMBER_CHANNELS; i++) build_step_values(i);
+#endif
+#if IR_SNAPSHOTS
+    for (uint8_t i = 0; i < NUMBER_CHANNELS; i++) publish(i, micros());
+#endif
+#if IR_FAILSAFE
+    for (uint8_t i = 0; i < FAILSAFE_TIMERS; i++) {
+        failsafe_timers[i].ticks = failsafe_ticks(IR_FAILSAFE_TIMEOUT_MS);
+        failsafe_timers[i].slot = FAILSAFE_NONE;
+    }
+    for (uint8_t i = 0; i < IR_FAILSAFE_SLOTS; i++) failsafe_wheel[i] = FAILSAFE_NONE;
+    failsafe_armed = 0;
+    failsafe_millis = millis();
+#endif
+    attach_receivers<NUMBER_RECEIVERS - 1>();
 }
 
-void update( void ) {
-    while ( head ) {
-        Event* p_event = dequeue();
-        IRSample ir = p_event->ir_event;
-        free(p_event);
+// Note the kinds of handlers set in the arrays per channel.
+static void scan_handlers( void ) {
+    for (uint8_t channel = 0; channel < NUMBER_CHANNELS; channel++) {
+        handler_kinds[channel] = (generic_handler ? 1 << EVENT_GENERIC : 0)
+            | (red_effected_handler[channel] ? 1 << EVENT_RED_EFFECTED : 0)
+            | (blue_effected_handler[channel] ? 1 << EVENT_BLUE_EFFECTED : 0)
+            | (red_changed_handler[channel] ? 1 << EVENT_RED_CHANGED : 0)
+            | (blue_changed_handler[channel] ? 1 << EVENT_BLUE_CHANGED : 0);
+    }
+}
+
+#if IR_SUBSCRIBERS
+// Free the slots unsubscribed during dispatching.
+static void free_dead_subscribers( void ) {
+    for (uint8_t slot = 0; slot < IR_SUBSCRIBERS; slot++) {
+        if (subscribers[slot].dead) {
+            subscribers[slot].dead = false;
+            subscribers[slot].handler = 0;
+        }
+    }
+    subscribers_dead = false;
+}
+#endif
+
+// Call the handlers of kind for ir, the one of the arrays (handler) first, until one sets ir.handled.
+static inline void call_handlers(uint8_t channel, uint8_t kind, EventHandler handler, IRSample &ir, ChannelState &state) {
+    if (handler && !ir.handled) {
+        IR_LOOP_STAT_INC(handler_calls);
+        handler(ir, state);
+    }
+#if IR_SUBSCRIBERS
+    subscriber_dispatches++;
+    for (uint8_t list = channel; ; list = NUMBER_CHANNELS) {
+        // The next index is read after the call, slots unsubscribed meanwhile are dead (skipped) but keep their link.
+        for (uint8_t i = subscriber_heads[list][kind]; i && !ir.handled; i = subscribers[i - 1].next) {
+            Subscriber &subscriber = subscribers[i - 1];
+            if (subscriber.dead) continue;
+            IR_LOOP_STAT_INC(handler_calls);
+            subscriber.handler(ir, state, subscriber.context);
+        }
+        if (list == NUMBER_CHANNELS) break;
+    }
+    if (!--subscriber_dispatches && subscribers_dead) free_dead_subscribers();
+#else
+    (void)channel;
+    (void)kind;
+#endif
+}
+
+// Trigger the event handlers of channel for ir (handlers may set ir.handled to skip the following ones).
+static void dispatch(uint8_t channel, IRSample &ir, ChannelState &state, bool red_effected, bool blue_effected,
+    int8_t old_red_value, int8_t old_blue_value) {
+    uint8_t kinds = handler_kinds[channel];
+#if IR_SUBSCRIBERS
+    kinds |= subscriber_kinds[channel] | subscriber_kinds[NUMBER_CHANNELS];
+#endif
+    if (!kinds) return;
+    if (kinds & 1 << EVENT_GENERIC) call_handlers(channel, EVENT_GENERIC, generic_handler, ir, state);
+    if (kinds & 1 << EVENT_RED_EFFECTED && red_effected) {
+        call_handlers(channel, EVENT_RED_EFFECTED, red_effected_handler[channel], ir, state);
+    }
+    if (kinds & 1 << EVENT_BLUE_EFFECTED && blue_effected) {
+        call_handlers(channel, EVENT_BLUE_EFFECTED, blue_effected_handler[channel], ir, state);
+    }
+    // Handlers before may have changed the state.
+    if (kinds & 1 << EVENT_RED_CHANGED && old_red_value != state.red.actual_step) {
+        call_handlers(channel, EVENT_RED_CHANGED, red_changed_handler[channel], ir, state);
+    }
+    if (kinds & 1 << EVENT_BLUE_CHANGED && old_blue_value != state.blue.actual_step) {
+        call_handlers(channel, EVENT_BLUE_CHANGED, blue_changed_handler[channel], ir, state);
+    }
+}
+
+#if IR_COALESCE
+/*
+    Dispatch pending for a channel while coalescing: its last IRSample, the actual steps before its first IRSample of
+    this update() and whether any of its IRSamples effected the subchannels.
+*/
+struct PendingDispatch {
+    IRSample ir;
+#if IR_STATS
+    // End of the frame of ir.
+    unsigned long micros;
+#endif
+    int8_t old_red_value;
+    int8_t old_blue_value;
+    bool red_effected;
+    bool blue_effected;
+};
+#endif
+
+#if IR_FAILSAFE
+/*
+    Failsafe timer wheel.
+*/
+static void failsafe_unlink(uint8_t index) {
+    FailsafeTimer &timer = failsafe_timers[index];
+    if (timer.slot == FAILSAFE_NONE) return;
+    if (timer.prev != FAILSAFE_NONE) failsafe_timers[timer.prev].next = timer.next;
+    else failsafe_wheel[timer.slot] = timer.next;
+    if (timer.next != FAILSAFE_NONE) failsafe_timers[timer.next].prev = timer.prev;
+    timer.slot = FAILSAFE_NONE;
+    failsafe_armed--;
+}
+
+// Restart the timer of subchannel index if active, else disarm it.
+static void failsafe_arm(uint8_t index, bool active) {
+    failsafe_unlink(index);
+    FailsafeTimer &timer = failsafe_timers[index];
+    if (!active || !timer.ticks) return;
+    uint8_t slot = (failsafe_tick + timer.ticks) & (IR_FAILSAFE_SLOTS - 1);
+    timer.rounds = (timer.ticks - 1) / IR_FAILSAFE_SLOTS;
+    timer.slot = slot;
+    timer.prev = FAILSAFE_NONE;
+    timer.next = failsafe_wheel[slot];
+    if (timer.next != FAILSAFE_NONE) failsafe_timers[timer.next].prev = index;
+    failsafe_wheel[slot] = index;
+    failsafe_armed++;
+}
+
+// Restart the timers of the subchannels effected by ir, only the modes the remote repeats (standard rc, combo pwm) keep
+// a subchannel that isn't 0 armed.
+static inline void failsafe_refresh(uint8_t channel, const IRSample &ir, uint8_t red, uint8_t blue,
+    const ChannelState &state) {
+    bool repeated = ir.escape || ir.mode == 1;
+    if (red != NO_COMMAND) failsafe_arm(channel << 1, repeated && state.red.actual_step);
+    if (blue != NO_COMMAND) failsafe_arm(channel << 1 | 1, repeated && state.blue.actual_step);
+}
+
+// Reset subchannel index and trigger the event handlers with a single output pwm PWM_BRAKE frame for it.
+static void failsafe_expire(uint8_t index) {
+    uint8_t channel = index >> 1;
+    bool blue = index & 1;
+    ChannelState &state = channel_states[channel];
+    int8_t old_red_value = state.red.actual_step;
+    int8_t old_blue_value = state.blue.actual_step;
+    (blue ? state.blue : state.red).actual_step = 0;
+#if IR_BINDINGS
+    bound_changed |= 1U << index;
+#endif
+    // No signature matches, the remote's next frame is applied even if it equals the last one.
+    state.previous = 0xFFFF;
+#if IR_PREFILTER
+    uint8_t sreg = SREG;
+    cli();
+    prefilter_previous[channel] = 0xFFFF;
+    SREG = sreg;
+#endif
+#if IR_SNAPSHOTS
+    publish(channel, micros());
+#endif
+    IRSample ir;
+    ir.raw = (channel & 0x3) << 12 | (channel >> 2) << 11 | (0x4 | blue) << 8 | PWM_BRAKE;
+    ir.set_checksum();
+    dispatch(channel, ir, state, !blue, blue, old_red_value, old_blue_value);
+}
+
+// Advance the wheel to millis() and expire the timers due, nothing to do while no timer is armed.
+static void failsafe_update( void ) {
+    unsigned long now = millis();
+    if (!failsafe_armed) {
+        failsafe_millis = now;
+        return;
+    }
+    while (failsafe_armed && now - failsafe_millis >= IR_FAILSAFE_TICK_MS) {
+        failsafe_millis += IR_FAILSAFE_TICK_MS;
+        uint8_t slot = ++failsafe_tick & (IR_FAILSAFE_SLOTS - 1);
+        // Unlink the timers due first, the event handlers may change timers of this slot.
+        uint16_t expired = 0;
+        for (uint8_t index = failsafe_wheel[slot]; index != FAILSAFE_NONE; ) {
+            FailsafeTimer &timer = failsafe_timers[index];
+            uint8_t next = timer.next;
+            if (timer.rounds) {
+                timer.rounds--;
+            } else {
+                failsafe_unlink(index);
+                expired |= 1U << index;
+            }
+            index = next;
+        }
+        if (expired) scan_handlers();
+        for (uint8_t index = 0; expired; index++, expired >>= 1) {
+            if (expired & 1) failsafe_expire(index);
+        }
+    }
+}
+#endif
+
+/*
+    Process queued IR events, if budgeted until budget_us are spent (checked after each event triggering handlers).
+    Returns the number of events still queued.
+*/
+static inline uint8_t process_events(bool budgeted, uint16_t budget_us) {
+    unsigned long start = budgeted ? micros() : 0;
+#if IR_DEFERRED_DECODE
+    decode_edges();
+#endif
+    // Handlers in the arrays may have been set since the last call (also used by failsafe_update()).
+    if (queue_tail != queue_head) scan_handlers();
+#if IR_FAILSAFE
+    // Before the queued events, they were received after the timeouts due by now.
+    failsafe_update();
+#endif
+#if IR_COALESCE
+    PendingDispatch pending[NUMBER_CHANNELS];
+    // Bit n set = channel n has a pending dispatch.
+    uint8_t pending_channels = 0;
+#endif
+    IRSample ir;
+    while (dequeue(ir)) {
         /*
             We can't rely on toggle bit only for redundancy check, since there are edge cases where it doesn't work.
             * First signal received could be 0 or 1.
             * When going from full forward to full backward on standard rc the stop signal will be missed and
               therefore both signals have same toggle bit.
             * We could use standard rc and pwm rc on the same channel and differentiate them by mode.
-            We still have an edge case: If first signal is on toggle 0 with data 0 and extended mode (0)
-            we will miss it, but in reality extended mode isn't in use.
+            We still have an edge case: If first signal is on toggle 0 with data 0 and extended mode (0) on channel 0
+            we will miss it, but in reality extended mode is hardly in use.
         */
+        if (!handled_mode(ir)) continue;
         uint8_t channel = ir.get_channel();
-        if (ir.checksum_ok() && channel_states[channel].previous != ir.get_state_signature()) {
-            channel_states[channel].previous = ir.get_state_signature();
+        ChannelState &state = channel_states[channel];
+#if IR_STATS
+        if (!ir.checksum_ok()) IR_LOOP_STAT_INC(checksum_errors);
+        else if (state.previous == ir.get_state_signature()) IR_LOOP_STAT_INC(redundant);
+#endif
+        if (ir.checksum_ok() && state.previous != ir.get_state_signature()) {
+            state.previous = ir.get_state_signature();
             // Values updated here.
-            int8_t old_red_value = channel_states[channel].red.actual_step;
-            switch (ir.get_red_command()) {
-                case STOP:
-                    if (channel_states[channel].red.alternative) break;
-                case RESET_VALUE:
-                    channel_states[channel].red.actual_step = 0;
-                    break;
-                case FORWARD:
-                    if (channel_states[channel].red.alternative) {
-                        channel_states[channel].red.actual_step ^= 0x01;
-                    } else {
-                        channel_states[channel].red.actual_step = channel_states[channel].red.steps;
-                    }
-                    break;
-                case BACKWARD:
-                    if (channel_states[channel].red.alternative) {
-                        channel_states[channel].red.actual_step ^= 0x02;
-                    } else {
-                        channel_states[channel].red.actual_step = -channel_states[channel].red.steps;
-                    }
-                    break;
-                case INCREASE_VALUE:
-                    if (channel_states[channel].red.actual_step < channel_states[channel].red.steps)
-                        channel_states[channel].red.actual_step++;
-                    break;
-                case DECREASE_VALUE:
-                    if (channel_states[channel].red.actual_step > (channel_states[channel].red.alternative ? 0 :
-                        -channel_states[channel].red.steps)) channel_states[channel].red.actual_step--;
-                    break;
+            int8_t old_red_value = state.red.actual_step;
+            int8_t old_blue_value = state.blue.actual_step;
+            uint8_t red, blue;
+            decode_commands(ir, red, blue);
+            apply_transition(red, state.red);
+            apply_transition(blue, state.blue);
+#if IR_SNAPSHOTS
+#if IR_STATS
+            publish(channel, dequeued_micros);
+#else
+            publish(channel, micros());
+#endif
+#endif
+#if IR_BINDINGS
+            if (state.red.actual_step != old_red_value) bound_changed |= 1U << (channel << 1);
+            if (state.blue.actual_step != old_blue_value) bound_changed |= 2U << (channel << 1);
+#endif
+#if IR_FAILSAFE
+            failsafe_refresh(channel, ir, red, blue, state);
+#endif
+#if IR_COALESCE
+            // Event handlers triggered after the queue is empty, increments of all IRSamples are already summed up.
+            PendingDispatch &p = pending[channel];
+            if (!(pending_channels & 1 << channel)) {
+                pending_channels |= 1 << channel;
+                p.old_red_value = old_red_value;
+                p.old_blue_value = old_blue_value;
+                p.red_effected = false;
+                p.blue_effected = false;
             }
-            int8_t old_blue_value = channel_states[channel].blue.actual_step;
-            switch (ir.get_blue_command()) {
-                case STOP:
-                    if (channel_states[channel].blue.alternative) break;
-                case RESET_VALUE:
-                    channel_states[channel].blue.actual_step = 0;
-                    break;
-                case FORWARD:
-                    if (channel_states[channel].blue.alternative) {
-                        channel_states[channel].blue.actual_step ^= 0x01;
-                    } else {
-                        channel_states[channel].blue.actual_step = channel_states[channel].blue.steps;
-                    }
-                    break;
-                case BACKWARD:
-                    if (channel_states[channel].blue.alternative) {
-                        channel_states[channel].blue.actual_step ^= 0x02;
+            p.ir = ir;
+#if IR_STATS
+            p.micros = dequeued_micros;
+#endif
+            p.red_effected |= red != NO_COMMAND;
+            p.blue_effected |= blue != NO_COMMAND;
+#else
+            // Event handlers triggered here.
+#if IR_STATS
+            stats_latency(dequeued_micros);
+#endif
+            dispatch(channel, ir, state, red != NO_COMMAND, blue != NO_COMMAND, old_red_value, old_blue_value);
+#endif
+            // The following events stay queued for the next call.
+            if (budgeted && micros() - start >= budget_us) break;
+        }
+#if IR_FAILSAFE
+        else if (ir.checksum_ok()) {
+            // Repeated frame, it only keeps the failsafe timers running.
+            uint8_t red, blue;
+            decode_commands(ir, red, blue);
+            failsafe_refresh(channel, ir, red, blue, state);
+        }
+#endif
+    }
+#if IR_COALESCE
+    for (uint8_t channel = 0; pending_channels; channel++, pending_channels >>= 1) {
+        if (!(pending_channels & 1)) continue;
+        PendingDispatch &p = pending[channel];
+#if IR_STATS
+        stats_latency(p.micros);
+#endif
+        dispatch(channel, p.ir, channel_states[channel], p.red_effected, p.blue_effected, p.old_red_value,
+            p.old_blue_value);
+    }
+#endif
+#if IR_BINDINGS
+    if (bound_changed) apply_bindings();
+#endif
+    return queue_tail - queue_head;
+}
+
+void update( void ) {
+    process_events(false, 0);
+}
+
+uint8_t update(uint16_t budget_us) {
+    return process_events(true, budget_us);
+}
+
+uint8_t get_pending_events( void ) {
+    return queue_tail - queue_head;
+}
+
+#if IR_SUBSCRIBERS
+// Recompute the kinds bits of list (channel or NUMBER_CHANNELS).
+static void update_subscriber_kinds(uint8_t list) {
+    uint8_t kinds = 0;
+    for (uint8_t kind = 0; kind < EVENT_KINDS; kind++) {
+        if (subscriber_heads[list][kind]) kinds |= 1 << kind;
+    }
+    subscriber_kinds[list] = kinds;
+}
+
+bool subscribe(uint8_t channel, uint8_t kind, ContextHandler handler, void *context) {
+    if ((channel >= NUMBER_CHANNELS && channel != ALL_CHANNELS) || kind >= EVENT_KINDS || !handler) return false;
+    uint8_t list = channel == ALL_CHANNELS ? NUMBER_CHANNELS : channel;
+    uint8_t slot = 0;
+    while (slot < IR_SUBSCRIBERS && subscribers[slot].handler) slot++;
+    if (slot == IR_SUBSCRIBERS) return false;
+    Subscriber &subscriber = subscribers[slot];
+    subscriber.context = context;
+    subscriber.next = 0;
+    subscriber.handler = handler;
+    // Append, handlers are called in the order they were subscribed.
+    uint8_t *link = &subscriber_heads[list][kind];
+    while (*link) link = &subscribers[*link - 1].next;
+    *link = slot + 1;
+    subscriber_kinds[list] |= 1 << kind;
+    return true;
+}
+
+void unsubscribe(ContextHandler handler, void *context) {
+    for (uint8_t list = 0; list <= NUMBER_CHANNELS; list++) {
+        for (uint8_t kind = 0; kind < EVENT_KINDS; kind++) {
+            uint8_t *link = &subscriber_heads[list][kind];
+            while (*link) {
+                Subscriber &subscriber = subscribers[*link - 1];
+                if (subscriber.handler == handler && subscriber.context == context) {
+                    *link = subscriber.next;
+                    if (subscriber_dispatches) {
+                        // Its next stays, dispatching may continue from it, the slot is freed afterwards.
+                        subscriber.dead = true;
+                        subscribers_dead = true;
                     } else {
-                        channel_states[channel].blue.actual_step = -channel_states[channel].blue.steps;
+                        subscriber.handler = 0;
                     }
-                    break;
-                case INCREASE_VALUE:
-                    if (channel_states[channel].blue.actual_step < channel_states[channel].blue.steps)
-                        channel_states[channel].blue.actual_step++;
-                    break;
-                case DECREASE_VALUE:
-                    if (channel_states[channel].blue.actual_step > (channel_states[channel].blue.alternative ? 0 :
-                        -channel_states[channel].blue.steps)) channel_states[channel].blue.actual_step--;
-                    break;
+                } else {
+                    link = &subscriber.next;
+                }
             }
-            // Event handlers triggered here.
-            if (generic_handler) generic_handler(ir, channel_states[channel]);
-            if (red_effected_handler[channel] && !ir.handled && ir.red_effected())
-                red_effected_handler[channel](ir, channel_states[channel]);
-            if (blue_effected_handler[channel] && !ir.handled && ir.blue_effected())
-                blue_effected_handler[channel](ir, channel_states[channel]);
-            if (red_changed_handler[channel] && !ir.handled
-                && old_red_value != channel_states[channel].red.actual_step)
-                    red_changed_handler[channel](ir, channel_states[channel]);
-            if (blue_changed_handler[channel] && !ir.handled
-                && old_blue_value != channel_states[channel].blue.actual_step)
-                    blue_changed_handler[channel](ir, channel_states[channel]);
         }
+        update_subscriber_kinds(list);
     }
 }
+#endif
 
 bool set_steps(uint8_t channel, uint8_t steps_red, uint8_t steps_blue) {
     if (channel >= NUMBER_CHANNELS) return false;
@@ -222,6 +1393,13 @@ bool set_steps(uint8_t channel, uint8_t steps_red, uint8_t steps_blue) {
     if (steps_blue < 1 || steps_blue > 127) return false;
     channel_states[channel].red.steps = steps_red;
     channel_states[channel].blue.steps = steps_blue;
+#if IR_BINDINGS
+    build_step_values(channel);
+    bound_changed |= 3U << (channel << 1);
+#endif
+#if IR_SNAPSHOTS
+    publish(channel, micros());
+#endif
     return true;
 }
 
@@ -229,11 +1407,119 @@ bool set_alternative_mode(uint8_t channel, bool red, bool blue) {
     if (channel >= NUMBER_CHANNELS) return false;
     channel_states[channel].red.alternative = red;
     channel_states[channel].blue.alternative = blue;
+#if IR_BINDINGS
+    // The tables serve both modes (alternative mode maps 0 to steps the same way).
+    bound_changed |= 3U << (channel << 1);
+#endif
+#if IR_SNAPSHOTS
+    publish(channel, micros());
+#endif
     return true;
 }
 
 ChannelState get_state_for_channel(uint8_t channel) {
+    if (channel >= NUMBER_CHANNELS) return ChannelState();
     return channel_states[channel];
 }
 
+#if IR_SNAPSHOTS
+bool get_snapshot(uint8_t channel, ChannelSnapshot &snapshot) {
+    if (channel >= NUMBER_CHANNELS) return false;
+    uint8_t latch;
+    do {
+        latch = snapshot_latch;
+        SNAPSHOT_BARRIER();
+        snapshot = snapshots[latch & 1][channel];
+        SNAPSHOT_BARRIER();
+    } while (latch != snapshot_latch);
+    return true;
+}
+
+void get_snapshots(ChannelSnapshot *snapshots_out) {
+    uint8_t latch;
+    do {
+        latch = snapshot_latch;
+        SNAPSHOT_BARRIER();
+        for (uint8_t channel = 0; channel < NUMBER_CHANNELS; channel++) {
+            snapshots_out[channel] = snapshots[latch & 1][channel];
+        }
+        SNAPSHOT_BARRIER();
+    } while (latch != snapshot_latch);
+}
+#endif
+
+#if IR_BINDINGS
+bool bind(uint8_t channel, bool blue, PowerFunctionsOutput &output, uint8_t flags) {
+    if (channel >= NUMBER_CHANNELS || binding_count >= IR_BINDINGS) return false;
+    Binding &binding = bindings[binding_count++];
+    binding.output = &output;
+    binding.subchannel = channel << 1 | blue;
+    binding.flags = flags;
+    // Set by the next update().
+    bound_changed |= 1U << binding.subchannel;
+    return true;
+}
+
+void unbind(PowerFunctionsOutput &output) {
+    for (uint8_t i = 0; i < binding_count; ) {
+        if (bindings[i].output == &output) bindings[i] = bindings[--binding_count];
+        else i++;
+    }
+}
+#endif
+
+#if IR_FAILSAFE
+bool set_failsafe(uint8_t channel, uint16_t timeout_red_ms, uint16_t timeout_blue_ms) {
+    if (channel >= NUMBER_CHANNELS) return false;
+    // Armed timers keep their deadline, unless they are switched off.
+    failsafe_timers[channel << 1].ticks = failsafe_ticks(timeout_red_ms);
+    failsafe_timers[channel << 1 | 1].ticks = failsafe_ticks(timeout_blue_ms);
+    if (!timeout_red_ms) failsafe_unlink(channel << 1);
+    if (!timeout_blue_ms) failsafe_unlink(channel << 1 | 1);
+    return true;
+}
+#endif
+
+uint16_t get_ram_footprint( void ) {
+    uint16_t bytes = sizeof(receivers) + sizeof(channel_states) + sizeof(generic_handler) + sizeof(red_effected_handler)
+        + sizeof(blue_effected_handler) + sizeof(red_changed_handler) + sizeof(blue_changed_handler)
+        + sizeof(event_queue) + sizeof(queue_head) + sizeof(queue_tail) + sizeof(queue_overflows)
+        + sizeof(handler_kinds);
+#if IR_SUBSCRIBERS
+    bytes += sizeof(subscribers) + sizeof(subscriber_heads) + sizeof(subscriber_kinds) + sizeof(subscriber_dispatches)
+        + sizeof(subscribers_dead);
+#endif
+#if IR_PREFILTER
+    bytes += sizeof(subscribed_channels) + sizeof(prefilter_previous) + sizeof(prefilter_drops);
+#endif
+#if IR_STATS
+    bytes += sizeof(stats_counters) + sizeof(stats_base) + sizeof(loop_counters) + sizeof(stats_high_water) + sizeof(stats_latency_min)
+        + sizeof(stats_latency_max) + sizeof(stats_latency_sum) + sizeof(stats_latency_count) + sizeof(queue_micros)
+        + sizeof(dequeued_micros);
+#endif
+#if IR_CAPTURE
+    bytes += sizeof(capture_buffer) + sizeof(capture_head) + sizeof(capture_tail) + sizeof(capture_lost);
+#endif
+#if IR_DEFERRED_DECODE
+    bytes += sizeof(edge_buffer) + sizeof(edge_head) + sizeof(edge_tail) + sizeof(edge_overflows);
+#if NUMBER_RECEIVERS > 1
+    bytes += sizeof(edge_receiver);
+#endif
+#endif
+#if NUMBER_RECEIVERS > 1
+    bytes += sizeof(merge_raw) + sizeof(merge_micros) + sizeof(merge_next);
+#endif
+#if IR_BINDINGS
+    bytes += sizeof(bindings) + sizeof(binding_count) + sizeof(step_values) + sizeof(bound_changed);
+#endif
+#if IR_SNAPSHOTS
+    bytes += sizeof(snapshots) + sizeof(snapshot_latch);
+#endif
+#if IR_FAILSAFE
+    bytes += sizeof(failsafe_timers) + sizeof(failsafe_wheel) + sizeof(failsafe_tick) + sizeof(failsafe_millis)
+        + sizeof(failsafe_armed);
+#endif
+    return bytes;
+}
+
 }; // end namespace
@@ -8,32 +8,59 @@
  * Warranty for your LEGO Power Functions items may void using this project.
  *
  *   - With init() (in setup() function) idle_isr() is attached and listens for start-stop-signal.
+ *   - With several receivers (IR_RECEIVER_PINS) each one has its own decoder state and interrupt routines, frames
+ *     decoded by more than one of them are merged before they are enqueued.
  *   - If start-stop-signal is detected sample_isr() is attached and samples the signal data.
  *   - Switch back to idle_isr() on signal end or sample error.
+ *   - With IR_ADAPTIVE_TIMING the bit thresholds are derived from the intervals of recently accepted frames.
  *   - If 16 bits were sampled successfully the sample value is enqueued for further processing as IRSample struct.
+ *   - With IR_PREFILTER samples with bad checksum, repeated samples and samples for unsubscribed channels are
+ *     dropped before they are enqueued (with IR_FAILSAFE repeats of standard rc and combo pwm frames are kept).
  *   - Queue is polled by update() (in loop() function) and event handlers are triggered.
+ *   - With IR_COALESCE update() first applies all queued events and then triggers the event handlers once per
+ *     channel, with the channel's last IRSample and the net change of its ChannelState.
+ *   - With IR_FAILSAFE each non-zero subchannel set by a standard rc or combo pwm frame has a timeout on a timer
+ *     wheel, refreshed by every frame for it (repeats included), update() resets the subchannels timed out.
+ *   - With IR_BINDINGS update() sets the outputs bound to subchannels whose actual_step changed, after the event
+ *     handlers, with the values of precomputed tables instead of value().
+ *   - With IR_SNAPSHOTS update() publishes each change of a ChannelState in two copies guarded by a sequence counter,
+ *     so interrupt routines can read consistent states while update() changes them.
+ *   - With IR_DEFERRED_DECODE only capture_isr() is attached, it records edge timestamps and the steps above
+ *     (except the interrupt routine swapping) are done by update().
  */
 #pragma once
 #include "Arduino.h"
 #include "BrixxSettings.h"
 
+class PowerFunctionsOutput;
+
 namespace PowerFunctionsIR {
 
 /*
-    Number of supported channels.
+    Number of supported channels (see IR_CHANNELS in BrixxSettings.h).
     This is used for arrays, where 1 element per channel is required, e.g. event handlers.
 */
-#define NUMBER_CHANNELS                4
+#define NUMBER_CHANNELS                IR_CHANNELS
+/*
+    Number of IR receivers (pins in IR_RECEIVER_PINS, see BrixxSettings.h).
+*/
+#define IR_COUNT_PINS(...)             IR_COUNT_PINS_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define IR_COUNT_PINS_(p1, p2, p3, p4, p5, p6, count, ...) count
+#define NUMBER_RECEIVERS               IR_COUNT_PINS(IR_RECEIVER_PINS)
 /*
     Sample bit timings.
     LOW bit         = 316 -  526 µs (typically  421µs)
     HIGH bit        = 526 -  947 µs (typically  711µs)
     START-STOP bit  = 947 - 1560 µs (typically 1184µs)
+    With IR_ADAPTIVE_TIMING the thresholds follow the learned intervals, see get_bit_timing().
 */
 #define LOW_MIN                      316
 #define HIGH_MIN                     526
 #define START_STOP_MIN               947
 #define START_STOP_MAX              1560
+#define LOW_TYPICAL                  421
+#define HIGH_TYPICAL                 711
+#define START_STOP_TYPICAL          1184
 /*
     Command codes for LEGO Power Functions standard remote control.
     FORWARD  = clockwise         =  255
@@ -58,6 +85,37 @@ namespace PowerFunctionsIR {
 #define INCREASE_VALUE              0x40
 #define DECREASE_VALUE              0x50
 #define RESET_VALUE                 0x80
+/*
+    Command codes for absolute pwm (single output pwm mode and combo pwm mode, used by third party transmitters).
+    PWM_FORWARD(1-7) / PWM_BACKWARD(1-7) set the speed step (scaled to the subchannel's steps).
+    FLOAT is the same as STOP, BRAKE (brake then float) the same as RESET_VALUE.
+*/
+#define PWM_FLOAT                   0x00
+#define PWM_FORWARD(step)           ((step) << 4 | 0x03)
+#define PWM_BACKWARD(step)          ((16 - (step)) << 4 | 0x03)
+#define PWM_BRAKE                   0x80
+/*
+    Command codes for single output clear/set/toggle/increment/decrement mode (besides INCREASE_VALUE and
+    DECREASE_VALUE) and extended mode.
+    TOGGLE_FULL_FORWARD  = full forward <-> stop     CLEAR/SET/TOGGLE_C1 = output pin C1 (forward)
+    TOGGLE_FULL_BACKWARD = full backward <-> stop    CLEAR/SET/TOGGLE_C2 = output pin C2 (backward)
+    TOGGLE_DIRECTION     = same speed, other direction
+    TOGGLE_FULL_DIRECTION = full forward <-> full backward
+*/
+#define TOGGLE_FULL_FORWARD         0x0C
+#define TOGGLE_DIRECTION            0x1C
+#define INCREASE_NUMERICAL          0x2C
+#define DECREASE_NUMERICAL          0x3C
+#define FULL_FORWARD                0x6C
+#define FULL_BACKWARD               0x7C
+#define TOGGLE_FULL_DIRECTION       0x8C
+#define CLEAR_C1                    0x9C
+#define SET_C1                      0xAC
+#define TOGGLE_C1                   0xBC
+#define CLEAR_C2                    0xCC
+#define SET_C2                      0xDC
+#define TOGGLE_C2                   0xEC
+#define TOGGLE_FULL_BACKWARD        0xFC
 /*
     Pseudo command code for LEGO Power Functions pwm remote control.
     If get_red/blue_command is queried for wrong channel.
@@ -102,33 +160,57 @@ struct IRSample {
     /*
         User interface functions for use in event handlers.
     */
+#if IR_CHANNELS > 4
+    // Get the remote control channel (0-3 = 1-4, 4-7 = 1-4 with address bit set, combo pwm mode has it in toggle).
+    uint8_t get_channel( void ) const { return (escape ? toggle : address) << 2 | channel; }
+#else
     // Get the remote control channel (0-3 = 1-4).
     uint8_t get_channel( void ) const { return channel; }
-    /* Convert channels to 0-7 (4-7 not used yet).
-    uint8_t get_channel( void ) const { return address << 2 | channel; } */
+#endif
     // Check if command was sent by LEGO Power Functions standard remote control (with joysticks).
     bool standard_rc( void ) const { return combo_direct_mode(); }
     // Check if command was sent by LEGO Power Functions pwm remote control (with speed control wheels).
     bool pwm_rc( void ) const { return single_output_mode_pwm(); }
-    // Check if command effects red/blue subchannel (standard rc always effects both).
-    bool red_effected( void ) const { return standard_rc() ? true : get_single_output_port() == 0; }
-    bool blue_effected( void ) const { return standard_rc() ? true : get_single_output_port() == 1; }
-    // Convert the actual command to an unique command code (see definitions above).
-    uint8_t get_command( void ) const { return standard_rc() ? data : data << 4; }
+    // Check if command effects red/blue subchannel (standard rc and combo pwm always effect both).
+    bool red_effected( void ) const { return get_red_command() != NO_COMMAND; }
+    bool blue_effected( void ) const { return get_blue_command() != NO_COMMAND; }
+    // Convert the actual command to an unique command code (see definitions above, red's command for combo pwm).
+    uint8_t get_command( void ) const
+        { return standard_rc() ? data : red_effected() ? get_red_command() : get_blue_command(); }
     // Convert the actual command to an unique command code only for red/blue subchannel.
-    uint8_t get_red_command( void ) const
-        { return standard_rc() ? data & 0x3 : get_single_output_port() == 0 ? data << 4 : NO_COMMAND; }
-    uint8_t get_blue_command( void ) const
-        { return standard_rc() ? data >> 2 & 0x3 : get_single_output_port() == 1 ? data << 4 : NO_COMMAND; }
+    uint8_t get_red_command( void ) const {
+        return standard_rc() ? data & 0x3 : combo_pwm_mode() ? get_pwm_command(data) : get_mode_red_command();
+    }
+    uint8_t get_blue_command( void ) const {
+        return standard_rc() ? data >> 2 & 0x3 : combo_pwm_mode() ? get_pwm_command(nibble2) : get_mode_blue_command();
+    }
     /*
         Helper functions for internal use only.
     */
     // Check the checksum.
     bool checksum_ok( void ) const { return (0xF ^ nibble1 ^ nibble2 ^ nibble3) == nibble4; }
-    // A signature from data, mode and toggle bit to identify redundancy commands.
-    uint8_t get_state_signature( void ) const { return data << 4 | mode << 3 | toggle; }
+    // Calculate and set the checksum (for sending).
+    void set_checksum( void ) { raw = (raw & 0xFFF0) | (0xF ^ nibble1 ^ nibble2 ^ nibble3); }
+    // A signature from all fields but the checksum to identify redundancy commands.
+    uint16_t get_state_signature( void ) const { return raw >> 4; }
     // Used for single_output_mode_pwm (pwm rc) to get the effected subchannel (red/blue).
     uint8_t get_single_output_port( void ) const { return mode & 0x1; }
+    // get_red/blue_command() of the single output and extended mode samples.
+    uint8_t get_mode_red_command( void ) const {
+        return single_output_mode() ? (get_single_output_port() == 0 ? get_single_output_command() : NO_COMMAND) :
+            extended_mode() ? (data == 0 ? RESET_VALUE : data == 1 ? INCREASE_VALUE : data == 2 ? DECREASE_VALUE :
+            NO_COMMAND) : NO_COMMAND;
+    }
+    uint8_t get_mode_blue_command( void ) const {
+        return single_output_mode() ? (get_single_output_port() == 1 ? get_single_output_command() : NO_COMMAND) :
+            extended_mode() && data == 4 ? TOGGLE_FULL_FORWARD : NO_COMMAND;
+    }
+    // Command code of pwm (float and brake data << 4, the steps data << 4 | 0x3).
+    static uint8_t get_pwm_command( uint8_t pwm ) { return pwm & 0x7 ? pwm << 4 | 0x03 : pwm << 4; }
+    // Command code in single output mode, clear/set/toggle/increment/decrement (data << 4 | 0xC, increment and
+    // decrement pwm as sent by the pwm rc data << 4) or pwm.
+    uint8_t get_single_output_command( void ) const
+        { return !(mode & 0x2) ? get_pwm_command(data) : (data & 0xE) == 0x4 ? data << 4 : data << 4 | 0x0C; }
     /*
         Determining the sending mode.
     */
@@ -136,72 +218,238 @@ struct IRSample {
     bool combo_direct_mode( void ) const { return !escape && mode == 1; }
     // This one is used by the LEGO Power Functions pwm remote control (with speed control wheels).
     bool single_output_mode_pwm( void ) const { return single_output_mode() && mode ^ 0x2; }
-    // The other modes seem to be unused.
+    // The other modes aren't used by LEGO remote controls, but by third party and custom transmitters.
     bool single_output_mode( void ) const { return !escape && mode & 0x4; }
     bool single_output_mode_toggle( void ) const { return single_output_mode() && mode & 0x2; }
     bool extended_mode( void ) const { return !escape && mode == 0; }
     bool combo_pwm_mode( void ) const { return escape; }
 };
 
+/*
+    SubchannelState struct.
+    Keep track of internal values effected by IR events for the red or blue subchannel (actual_step, value()).
+    Remember the steps and value tracking mode set for the subchannel (steps, alternative).
+*/
+struct SubchannelState {
+    int8_t actual_step;
+    uint8_t steps: 7; // max steps 127
+    uint8_t alternative: 1;
+    int16_t value( void ) const { return alternative ? map(actual_step, 0, steps, 0, 255) : 
+        map(actual_step, -steps, steps, -255, 255); } 
+    uint8_t bit_switches( void ) const { return actual_step & 0x03; }
+};
+
 /*
     ChannelState struct.
     Remember the signature of last event to filter out redundant signals (previous).
-    Keep track of internal values effected by IR events (actual_step, value()).
-    Remember the steps set for each channel and subchannel (steps).
+    Keep track of both subchannels' states (red, blue).
 */
 struct ChannelState {
-    uint8_t previous;
-    struct {
-        int8_t actual_step;
-        uint8_t steps: 7;
-        uint8_t alternative: 1;
-        int16_t value( void ) const { return alternative ? map(actual_step, 0, steps, 0, 255) : 
-            map(actual_step, -steps, steps, -255, 255); } 
-        uint8_t bit_switches( void ) const { return actual_step & 0x03; }
-    } red;
-    struct {
-        int8_t actual_step;
-        uint8_t steps: 7; // max steps 127
-        uint8_t alternative: 1;
-        int16_t value( void ) const { return alternative ? map(actual_step, 0, steps, 0, 255) : 
-            map(actual_step, -steps, steps, -255, 255); } 
-        uint8_t bit_switches( void ) const { return actual_step & 0x03; }
-    } blue;
+    uint16_t previous;
+    SubchannelState red;
+    SubchannelState blue;
+};
+
+#if IR_BINDINGS
+/*
+    Binding flags (see bind()).
+    BIND_REVERSE  = forward drives c2 and backward c1
+    BIND_INVERT   = inverted output levels (255 - value), for drivers switching on low
+    BIND_SWITCHES = in alternative mode the bit switches FORWARD / BACKWARD turn c1 / c2 fully on (else value() 0-255
+                    on c1)
+*/
+#define BIND_REVERSE                0x01
+#define BIND_INVERT                 0x02
+#define BIND_SWITCHES               0x04
+#endif
+
+#if IR_SNAPSHOTS
+/*
+    ChannelSnapshot struct - a ChannelState as published by update(), the number of changes of the channel's state
+    (sequence, wraps around at 65535) and the time of the change in µs (micros() of the frame's update() call, with
+    IR_STATS the time the frame was received). Compare sequence to skip states already seen.
+*/
+struct ChannelSnapshot {
+    ChannelState state;
+    uint16_t sequence;
+    unsigned long micros;
 };
+#endif
 
 /*
     Sampling IR events using an external interrupt pin.
 */
-// Interrupt service routing while not sampling (attached by init() or sample_isr()).
+// Interrupt service routing while not sampling (attached by init() or sample_isr(), first receiver).
 void idle_isr( void );
-// Interrupt service routing for sampling (attached by idle_isr()).
+// Interrupt service routing for sampling (attached by idle_isr(), first receiver).
 void sample_isr( void );
+#if IR_DEFERRED_DECODE
+// Interrupt service routing for deferred decoding, only records the edge's timestamp (attached by init(), first
+// receiver).
+void capture_isr( void );
+// Decode the recorded edges and enqueue sampled IR events (called by update()).
+void decode_edges( void );
+#endif
 
 /*
     Event processing.
+    Per event the handlers are called in the order of the event kinds below, for each kind the handler of the arrays
+    first and then the subscribed ones (channel's first, then ALL_CHANNELS'), in the order they were subscribed. A
+    handler setting ir.handled skips all following ones. update() notes which kinds have handlers per channel once per
+    call, so events of channels without handlers cost a single test. Assignments to the arrays from within handlers
+    take effect with the next update() call.
 */
+#define EVENT_GENERIC                  0
+#define EVENT_RED_EFFECTED             1
+#define EVENT_BLUE_EFFECTED            2
+#define EVENT_RED_CHANGED              3
+#define EVENT_BLUE_CHANGED             4
+#define EVENT_KINDS                    5
 // Event handler definition.
 typedef void (*EventHandler)(IRSample&, ChannelState&);
 // Event handlers - generic_handler is called for every type of event.
 extern EventHandler generic_handler;
-// These are called if the corresponding channel and subchannel is effected (channels = index 0-3).
+// These are called if the corresponding channel and subchannel is effected (channels = index 0-NUMBER_CHANNELS-1).
 extern EventHandler red_effected_handler[NUMBER_CHANNELS];
 extern EventHandler blue_effected_handler[NUMBER_CHANNELS];
-// These are called if the value associated with the channel and subchannel changes (channels = index 0-3).
+// These are called if the value associated with the channel and subchannel changes (channels = index
+// 0-NUMBER_CHANNELS-1).
 extern EventHandler red_changed_handler[NUMBER_CHANNELS];
 extern EventHandler blue_changed_handler[NUMBER_CHANNELS];
+#if IR_SUBSCRIBERS
+// Event handler with the context pointer given to subscribe().
+typedef void (*ContextHandler)(IRSample&, ChannelState&, void*);
+// Channel of subscriptions for all channels.
+#define ALL_CHANNELS                0xFF
+// Subscribe handler with context to events of kind (EVENT_*) of channel (or ALL_CHANNELS), e.g. a method of an object:
+// subscribe(0, EVENT_RED_CHANGED, member_handler<Motor, &Motor::on_red>, &motor). False if channel or kind is
+// invalid, handler is 0 or IR_SUBSCRIBERS handlers are subscribed.
+bool subscribe(uint8_t channel, uint8_t kind, ContextHandler handler, void *context);
+// Remove all subscriptions of handler with context. Handlers may (un)subscribe themselves and others, handlers
+// unsubscribed during an event aren't called for it anymore.
+void unsubscribe(ContextHandler handler, void *context);
+// ContextHandler calling method of the object passed as context.
+template<class T, void (T::*method)(IRSample&, ChannelState&)>
+void member_handler(IRSample &ir, ChannelState &state, void *object) {
+    (static_cast<T*>(object)->*method)(ir, state);
+}
+#endif
 /*
-    Event struct - event queue element.
-    Consists of IRSample and pointer to the next Event.
+    Event queue - fixed size ring buffer of IRSample values (size see IR_QUEUE_SIZE in BrixxSettings.h).
+    Single producer (sample_isr) and single consumer (update), each side only writes its own position,
+    so neither side allocates memory or locks interrupts.
 */
-struct Event {
-    IRSample ir_event;
-    Event* next;
+// Add an element to the queue (false if the queue is full, the sample is dropped and counted as overflow then).
+bool enqueue(const IRSample &sample);
+// Remove the first element from the queue (false if the queue is empty).
+bool dequeue(IRSample &sample);
+// Hand a sample on like the interrupt routines do, through the pre-filter (IR_PREFILTER) into the queue, received now
+// for the latency statistics (IR_STATS). Locks interrupts, false if the queue is full.
+bool submit(const IRSample &sample);
+// Number of samples dropped since init() because the queue was full.
+uint16_t get_queue_overflows( void );
+#if IR_DEFERRED_DECODE
+// Number of edges dropped since init() because the edge buffer was full (see IR_EDGE_BUFFER_SIZE).
+uint16_t get_edge_overflows( void );
+#endif
+#if IR_PREFILTER
+/*
+    PrefilterDrops struct.
+    Number of samples dropped by the pre-filter per reason, before they were enqueued.
+*/
+struct PrefilterDrops {
+    uint16_t checksum;
+    uint16_t repeated;
+    uint16_t unsubscribed;
 };
-// Add an element to the queue.
-void enqueue(IRSample &sample);
-// Remove the first element from the queue.
-Event* dequeue( void );
+// Get the pre-filter's drop counters.
+PrefilterDrops get_prefilter_drops( void );
+#endif
+
+#if NUMBER_RECEIVERS > 1
+/*
+    ReceiverStats struct - reception of one IR receiver since init(), to find good places for the receivers.
+    Frames decoded by the receiver (frames), the ones of them another receiver had decoded first (merged) and signal
+    errors while sampling (errors). Counters wrap around at 65535.
+*/
+struct ReceiverStats {
+    uint16_t frames;
+    uint16_t merged;
+    uint16_t errors;
+};
+// Get the counters of receiver (index in IR_RECEIVER_PINS).
+ReceiverStats get_receiver_stats(uint8_t receiver);
+#endif
+
+#if IR_ADAPTIVE_TIMING
+/*
+    BitTiming struct - the learned mean intervals and the thresholds derived from them (all in µs).
+    Each mean starts at its typical value and moves 1/16 of the way to the means of each frame passing the checksum,
+    clamped to 75-125% of the typical value. The thresholds are the midpoints between neighbouring means, half the low
+    mean (more tolerant than LOW_MIN, noise edges rarely make a frame with a valid checksum) and 21/16 of the
+    start-stop mean.
+*/
+struct BitTiming {
+    uint16_t low;
+    uint16_t high;
+    uint16_t start_stop;
+    uint16_t low_min;
+    uint16_t high_min;
+    uint16_t start_stop_min;
+    uint16_t start_stop_max;
+};
+// Get the bit timing of receiver (index in IR_RECEIVER_PINS).
+BitTiming get_bit_timing(uint8_t receiver = 0);
+#endif
+
+#if IR_STATS
+/*
+    Stats struct - statistics of the IR pipeline since init() or reset_stats().
+    Counters wrap around at 65535, latencies are µs from the end of a frame to dispatching it in update().
+*/
+struct Stats {
+    // Sampling: start-stop-signals detected, restarts on a start-stop-signal while sampling, signal errors
+    // (interval out of bit timings) and frames of 16 bit sampled.
+    uint16_t start_stops;
+    uint16_t restarts;
+    uint16_t timing_errors;
+    uint16_t frames;
+    // Processing: frames failing checksum_ok(), dropped as redundant and event handler calls.
+    uint16_t checksum_errors;
+    uint16_t redundant;
+    uint16_t handler_calls;
+    // Maximum number of samples waiting in the queue.
+    uint8_t queue_high_water;
+    // Latency of frames dispatched.
+    unsigned long latency_min;
+    unsigned long latency_max;
+    unsigned long latency_mean;
+};
+// Get the statistics.
+Stats get_stats( void );
+// Restart the statistics.
+void reset_stats( void );
+#endif
+
+#if IR_CAPTURE
+/*
+    Capture - the intervals between falling edges (micros_diff of idle_isr() / sample_isr()) in a ring of
+    IR_CAPTURE_SIZE bytes, to be dumped via serial and replayed on the host (see extras/host/replay.cpp). Only the
+    first receiver is captured.
+    Intervals are delta encoded in units of 4 µs (the resolution of micros() on 16 MHz boards):
+    * 0x00-0xEF: one byte, interval = byte * 4 µs (up to 956 µs, the low and high bits).
+    * 0xF0-0xFF: two bytes, interval = ((first & 0x0F) << 8 | second) * 4 µs (up to 16372 µs, the start-stop-signal).
+    * CAPTURE_LONG_GAP: any longer interval, decoded the same way as an error.
+    * CAPTURE_LOST: edges were dropped because the ring was full, replay resumes like after a long gap.
+*/
+#define CAPTURE_ESCAPE           0xF0
+#define CAPTURE_LONG_GAP       0xFFFE
+#define CAPTURE_LOST           0xFFFF
+// Copy up to size bytes of the capture to buffer and remove them from the ring, returns the number of bytes copied.
+uint16_t read_capture(uint8_t *buffer, uint16_t size);
+// Write the whole capture to out (e.g. Serial) and remove it from the ring.
+void dump_capture(Print &out);
+#endif
 
 /*
     User interface functions.
@@ -210,11 +458,44 @@ Event* dequeue( void );
 void init( void );
 // Call PowerFunctionsIR::update() in loop() to process IR events.
 void update( void );
+// Like update(), but stops after the event that used up budget_us (at least one event per call), the remaining events
+// stay queued in order for the next call. Returns the number of events still queued. With IR_DEFERRED_DECODE all
+// recorded edges are decoded first, with IR_COALESCE the handlers of the processed events run after the budget check.
+uint8_t update(uint16_t budget_us);
+// Number of IR events queued and not processed by update() yet.
+uint8_t get_pending_events( void );
 // This can be used to change the steps attributes of the channel's ChannelState.
 bool set_steps(uint8_t channel, uint8_t steps_red, uint8_t steps_blue);
 // This can be used to change value tracking to "alternative mode" (0-225 / 2 bit on-off-switch)
 bool set_alternative_mode(uint8_t channel, bool red, bool blue);
-// Get the ChannelState for channel.
+// Get the ChannelState for channel (all 0 for an invalid channel), from loop() context only, see get_snapshot().
 ChannelState get_state_for_channel(uint8_t channel);
+#if IR_SNAPSHOTS
+// Get the last state published for channel, false if channel is invalid. Lock free, safe in interrupt routines (e.g.
+// a control loop on a timer): neither update() nor the reader waits for the other and interrupts stay enabled.
+bool get_snapshot(uint8_t channel, ChannelSnapshot &snapshot);
+// Get the snapshots of all channels (NUMBER_CHANNELS elements), all taken at the same time.
+void get_snapshots(ChannelSnapshot *snapshots);
+#endif
+#if IR_BINDINGS
+// Bind the red (blue = false) or blue subchannel of channel to output (flags BIND_*), update() sets output to the
+// subchannel's value whenever it changes: forward on c1, backward on c2. Returns false if channel is invalid or
+// IR_BINDINGS bindings exist.
+bool bind(uint8_t channel, bool blue, PowerFunctionsOutput &output, uint8_t flags = 0);
+// Remove all bindings of output.
+void unbind(PowerFunctionsOutput &output);
+#endif
+#if IR_FAILSAFE
+// Set the failsafe timeouts of the channel's subchannels in ms (0 = off, default IR_FAILSAFE_TIMEOUT_MS).
+// On expiry update() resets actual_step and previous and triggers the event handlers with a single output pwm
+// PWM_BRAKE frame for the subchannel, as if it was received.
+bool set_failsafe(uint8_t channel, uint16_t timeout_red_ms, uint16_t timeout_blue_ms);
+#endif
+// Static RAM used by the IR receiver in bytes (channel states, handler tables and buffers of the settings in use).
+uint16_t get_ram_footprint( void );
+#if IR_PREFILTER
+// Only pass samples for these channels (bit 0-7 = channel 0-7) through the pre-filter (default all).
+void set_subscribed_channels(uint8_t channel_mask);
+#endif
 
 }; // end namespace
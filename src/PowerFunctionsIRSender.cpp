@@ -0,0 +1,213 @@
+/*
+ * PowerFunctionsIRSender.cpp - Library to send LEGO Power Functions IR commands
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ * Note: Although this project aims to connect LEGO Power Functions hardware to Arduino without damaging anything else
+ * then just a few extension cables, I'll take no responsibility for any damage done to any of your hardware.
+ * Warranty for your LEGO Power Functions items may void using this project.
+ */
+#include "PowerFunctionsIRSender.h"
+
+namespace PowerFunctionsIR {
+
+static_assert(IR_SEND_QUEUE_SIZE >= 2 && IR_SEND_QUEUE_SIZE <= 128
+    && !(IR_SEND_QUEUE_SIZE & (IR_SEND_QUEUE_SIZE - 1)), "IR_SEND_QUEUE_SIZE must be a power of 2 between 2 and 128");
+
+/*
+    Message segments: start bit mark and space, mark and space of 16 data bits (MSB first), stop bit mark and space,
+    pause until the next message.
+*/
+#define SEGMENT_START_SPACE            1
+#define SEGMENT_STOP_SPACE            35
+#define SEGMENT_PAUSE                 36
+
+/*
+    Variables.
+*/
+// Send queue, same scheme as the event queue but send() is the producer and carrier_tick() the consumer.
+volatile uint16_t send_queue[IR_SEND_QUEUE_SIZE];
+volatile uint8_t send_head;
+volatile uint8_t send_tail;
+// Toggle bit for the next command, per channel.
+uint8_t send_toggle;
+// Sender state, only changed by carrier_tick() while busy.
+volatile bool send_busy;
+volatile bool send_mark;
+uint16_t send_raw;
+uint8_t send_repeat;
+uint8_t send_segment;
+uint16_t send_cycles;
+uint16_t send_elapsed;
+
+/*
+    Carrier timer.
+*/
+#if defined(TIMER5_OVF_vect)
+ISR(TIMER5_OVF_vect) {
+    carrier_tick();
+}
+
+static void set_carrier(bool on) {
+    send_mark = on;
+    if (on) TCCR5A |= _BV(COM5A1); else TCCR5A &= ~_BV(COM5A1);
+}
+
+static void enable_carrier_interrupt(bool on) {
+    if (on) {
+        TIFR5 = _BV(TOV5);
+        TIMSK5 |= _BV(TOIE5);
+    } else {
+        TIMSK5 &= ~_BV(TOIE5);
+    }
+}
+
+static void init_carrier( void ) {
+    pinMode(IR_SEND_PIN, OUTPUT);
+    digitalWrite(IR_SEND_PIN, LOW);
+    // Fast pwm with ICR5 as top (mode 14), no prescaler, carrier duty cycle 1/3, output disconnected until a mark.
+    TCCR5A = _BV(WGM51);
+    TCCR5B = _BV(WGM53) | _BV(WGM52) | _BV(CS50);
+    ICR5 = F_CPU / CARRIER_HZ - 1;
+    OCR5A = F_CPU / CARRIER_HZ / 3;
+}
+#else
+// No carrier timer on this platform, carrier_tick() has to be called by someone else (e.g. the host simulator).
+static void set_carrier(bool on) { send_mark = on; }
+static void enable_carrier_interrupt(bool on) { (void)on; }
+static void init_carrier( void ) {}
+#endif
+
+/*
+    Sending.
+*/
+// Length of a segment in carrier cycles.
+static inline uint16_t segment_cycles(uint8_t segment) {
+    if (!(segment & 1)) return MARK_CYCLES;
+    if (segment == SEGMENT_START_SPACE || segment == SEGMENT_STOP_SPACE) return START_STOP_SPACE_CYCLES;
+    return send_raw & 1 << (15 - (segment - 3) / 2) ? HIGH_SPACE_CYCLES : LOW_SPACE_CYCLES;
+}
+
+// Protocol's time from the start of one message to the start of the next repeat (1 to 4), in message lengths.
+static inline uint8_t repeat_interval(uint8_t repeat, uint8_t channel) {
+    return repeat < 3 ? 5 : 6 + 2 * (channel + 1);
+}
+
+// Take the next command from the queue and pause (protocol's delay before the first message), false if empty.
+static bool load_command( void ) {
+    uint8_t head = send_head;
+    if (head == send_tail) return false;
+    send_raw = send_queue[head & (IR_SEND_QUEUE_SIZE - 1)];
+    send_head = head + 1;
+    send_repeat = 0;
+    send_segment = SEGMENT_PAUSE;
+    uint8_t channel = send_raw >> 12 & 0x3;
+    send_cycles = channel < 3 ? (3 - channel) * MESSAGE_CYCLES : 1;
+    return true;
+}
+
+void carrier_tick( void ) {
+    send_elapsed++;
+    if (--send_cycles) return;
+    if (++send_segment < SEGMENT_PAUSE) {
+        // Next mark or space.
+        set_carrier(!(send_segment & 1));
+        send_cycles = segment_cycles(send_segment);
+    } else if (send_segment == SEGMENT_PAUSE) {
+        // Message sent, pause until the next repeat or command.
+        if (++send_repeat < IR_SEND_REPEATS) {
+            uint16_t interval = repeat_interval(send_repeat, send_raw >> 12 & 0x3) * MESSAGE_CYCLES;
+            send_cycles = interval > send_elapsed ? interval - send_elapsed : 1;
+        } else if (!load_command()) {
+            enable_carrier_interrupt(false);
+            send_busy = false;
+        }
+    } else {
+        // Pause is over, start the message with the start bit's mark.
+        send_segment = 0;
+        send_elapsed = 0;
+        set_carrier(true);
+        send_cycles = MARK_CYCLES;
+    }
+}
+
+bool carrier_on( void ) {
+    return send_mark;
+}
+
+/*
+    User interface functions.
+*/
+void init_sender( void ) {
+    init_carrier();
+    set_carrier(false);
+}
+
+// Channel and address bit of a raw sample for channel 0-7.
+static inline uint16_t channel_bits(uint8_t channel) {
+    return (uint16_t)(channel & 0x3) << 12 | (uint16_t)(channel >> 2) << 11;
+}
+
+bool send(IRSample sample) {
+    uint8_t channel = sample.address << 2 | sample.channel;
+    if (!sample.escape) {
+        // Toggle bit changes with every new command (not with repeats).
+        sample.raw = (sample.raw & 0x7FFF) | (uint16_t)(send_toggle >> channel & 1) << 15;
+        send_toggle ^= 1 << channel;
+    }
+    sample.set_checksum();
+    uint8_t tail = send_tail;
+    if ((uint8_t)(tail - send_head) >= IR_SEND_QUEUE_SIZE) return false;
+    send_queue[tail & (IR_SEND_QUEUE_SIZE - 1)] = sample.raw;
+    send_tail = tail + 1;
+    // The interrupt is disabled while not busy, so it can't interfere here.
+    if (!send_busy && load_command()) {
+        send_busy = true;
+        enable_carrier_interrupt(true);
+    }
+    return true;
+}
+
+bool send_standard_rc(uint8_t channel, uint8_t red_command, uint8_t blue_command) {
+    if (channel > 7 || red_command > BACKWARD || blue_command > BACKWARD) return false;
+    // Combo direct mode.
+    IRSample sample;
+    sample.raw = channel_bits(channel) | 0x1 << 8 | (blue_command << 2 | red_command) << 4;
+    return send(sample);
+}
+
+bool send_pwm_rc(uint8_t channel, bool blue, uint8_t command) {
+    if (channel > 7) return false;
+    // Increment/decrement in single output clear/set/toggle mode, reset is single output pwm mode's brake.
+    uint8_t mode;
+    switch (command) {
+        case INCREASE_VALUE:
+        case DECREASE_VALUE:
+            mode = 0x6;
+            break;
+        case RESET_VALUE:
+            mode = 0x4;
+            break;
+        default:
+            return false;
+    }
+    IRSample sample;
+    sample.raw = channel_bits(channel) | (mode | blue) << 8 | (command >> 4) << 4;
+    return send(sample);
+}
+
+bool send_combo_pwm(uint8_t channel, uint8_t red_command, uint8_t blue_command) {
+    if (channel > 7 || IRSample::get_pwm_command(red_command >> 4) != red_command
+        || IRSample::get_pwm_command(blue_command >> 4) != blue_command) return false;
+    // Escape bit set, the address bit takes the toggle bit's place, blue's pwm takes address and mode.
+    IRSample sample;
+    sample.raw = (uint16_t)(channel >> 2) << 15 | 0x1 << 14 | (uint16_t)(channel & 0x3) << 12 | (blue_command >> 4) << 8
+        | (red_command >> 4) << 4;
+    return send(sample);
+}
+
+bool sending( void ) {
+    return send_busy;
+}
+
+}; // end namespace
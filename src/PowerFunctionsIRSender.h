@@ -0,0 +1,64 @@
+/*
+ * PowerFunctionsIRSender.h - Library to send LEGO Power Functions IR commands
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ * Note: Although this project aims to connect LEGO Power Functions hardware to Arduino without damaging anything else
+ * then just a few extension cables, I'll take no responsibility for any damage done to any of your hardware.
+ * Warranty for your LEGO Power Functions items may void using this project.
+ *
+ *   - send() and its helpers set toggle bit and checksum of an IRSample and enqueue it, they never block.
+ *   - The carrier timer's overflow interrupt calls carrier_tick() once per carrier cycle (38 kHz), which switches
+ *     the carrier on for marks and off for spaces and pauses.
+ *   - Each command is sent IR_SEND_REPEATS times with the protocol's channel dependent pauses, then the next
+ *     command is taken from the queue. The interrupt is disabled while the queue is empty.
+ */
+#pragma once
+#include "Arduino.h"
+#include "BrixxSettings.h"
+#include "PowerFunctionsIR.h"
+
+namespace PowerFunctionsIR {
+
+/*
+    Bit timings in carrier cycles (38 kHz = 26.3 µs).
+    MARK            =  6 cycles ( 158 µs) at the start of each bit
+    LOW space       = 10 cycles ( 263 µs)
+    HIGH space      = 21 cycles ( 553 µs)
+    START-STOP space= 39 cycles (1026 µs)
+    Maximum message length (tm), repeat pauses are multiples of it.
+*/
+#define CARRIER_HZ                 38000
+#define MARK_CYCLES                    6
+#define LOW_SPACE_CYCLES              10
+#define HIGH_SPACE_CYCLES             21
+#define START_STOP_SPACE_CYCLES       39
+#define MESSAGE_CYCLES               608
+
+/*
+    Sending.
+*/
+// Carrier timer interrupt routine (called by the timer interrupt, public for simulation).
+void carrier_tick( void );
+// True while the carrier is switched on (a mark is sent).
+bool carrier_on( void );
+
+/*
+    User interface functions.
+*/
+// Call PowerFunctionsIR::init_sender() in setup() if you want to send IR commands.
+void init_sender( void );
+// Enqueue sample for sending, toggle bit (unless combo pwm mode) and checksum are set, false if the queue is full.
+bool send(IRSample sample);
+// Send a standard rc command (STOP, FORWARD, BACKWARD for each subchannel) on channel (0-7, 4-7 set the
+// address bit).
+bool send_standard_rc(uint8_t channel, uint8_t red_command, uint8_t blue_command);
+// Send a pwm rc command (INCREASE_VALUE, DECREASE_VALUE, RESET_VALUE) for subchannel red or blue on channel (0-7).
+bool send_pwm_rc(uint8_t channel, bool blue, uint8_t command);
+// Send absolute pwm commands (PWM_FLOAT, PWM_FORWARD(1-7), PWM_BACKWARD(1-7), PWM_BRAKE) for both subchannels in one
+// frame (combo pwm mode) on channel (0-7).
+bool send_combo_pwm(uint8_t channel, uint8_t red_command, uint8_t blue_command);
+// True while commands are sent or waiting to be sent.
+bool sending( void );
+
+}; // end namespace
@@ -1,4 +1,7 @@
 #include "PowerFunctionsOutput.h"
+#if PF_OUT_SOFT_PWM
+#include "SoftPWM.h"
+#endif
 
 PowerFunctionsOutput::PowerFunctionsOutput(uint8_t pin_c1, uint8_t pin_c2)
 {
@@ -6,18 +9,32 @@ PowerFunctionsOutput::PowerFunctionsOutput(uint8_t pin_c1, uint8_t pin_c2)
     _pin_c2 = pin_c2;
     pinMode(_pin_c1, OUTPUT);
     pinMode(_pin_c2, OUTPUT);
+#if PF_OUT_SOFT_PWM
+    if (digitalPinToTimer(_pin_c1) == NOT_ON_TIMER) _soft_c1 = SoftPWM::attach(_pin_c1);
+    if (digitalPinToTimer(_pin_c2) == NOT_ON_TIMER) _soft_c2 = SoftPWM::attach(_pin_c2);
+#endif
     off();
 }
 
 void PowerFunctionsOutput::c1_set(uint8_t value)
 {
+#if PF_OUT_SOFT_PWM
+    if (_soft_c1) SoftPWM::write(_pin_c1, value);
+    else analogWrite(_pin_c1, value);
+#else
     analogWrite(_pin_c1, value);
+#endif
     _value_c1 = value;
 }
 
 void PowerFunctionsOutput::c2_set(uint8_t value)
 {
+#if PF_OUT_SOFT_PWM
+    if (_soft_c2) SoftPWM::write(_pin_c2, value);
+    else analogWrite(_pin_c2, value);
+#else
     analogWrite(_pin_c2, value);
+#endif
     _value_c2 = value;
 }
 
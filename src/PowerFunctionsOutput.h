@@ -30,9 +30,17 @@ class PowerFunctionsOutput
     bool c2_is_off( void ) const { return _value_c2 == 0; }
     // getters both
     bool is_off( void ) const { return c1_is_off() && c2_is_off(); }
+    // pins
+    uint8_t c1_pin( void ) const { return _pin_c1; }
+    uint8_t c2_pin( void ) const { return _pin_c2; }
   private:
     uint8_t _pin_c1;
     uint8_t _pin_c2;
     uint8_t _value_c1 = 0;
     uint8_t _value_c2 = 0;
+#if PF_OUT_SOFT_PWM
+    // pins driven by SoftPWM
+    bool _soft_c1 = false;
+    bool _soft_c2 = false;
+#endif
 };
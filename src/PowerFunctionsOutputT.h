@@ -0,0 +1,164 @@
+/*
+  PowerFunctionsOutputT.h - PowerFunctionsOutput with compile time pin pairs, e.g. PowerFunctionsOutputT<PF_OUT_A1>.
+  Created by Heiko Finzel, 2017.
+
+  Port, bit and timer compare register of both pins are resolved at compile time, so on Arduino Mega each setter
+  compiles down to a few direct register writes instead of analogWrite() and its pin lookup tables.
+  On other boards the setters fall back to analogWrite(). Use PowerFunctionsOutput if pins are only known at runtime.
+*/
+#pragma once
+#include "Arduino.h"
+#include "BrixxSettings.h"
+#if PF_OUT_SOFT_PWM
+#include "SoftPWM.h"
+#endif
+
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__) || defined(BRIXX_HOST_SFR)
+#define PF_OUTPUT_DIRECT_IO 1
+#else
+#define PF_OUTPUT_DIRECT_IO 0
+#endif
+
+namespace PowerFunctionsOutputIO {
+
+/*
+    Register addresses (data memory) and bits of an Arduino Mega pin.
+    ocr is 0 for pins not driven by a timer, ocr16 is set for the 16 bit timers 1, 3, 4 and 5.
+*/
+struct PinInfo {
+    uint16_t port;
+    uint8_t bit;
+    uint16_t tccr;
+    uint8_t com_bit;
+    uint16_t ocr;
+    bool ocr16;
+};
+
+constexpr PinInfo pin_info(uint8_t pin) {
+    return
+        //      pin                  PORTx  bit  TCCRnA  COMnx1  OCRnx   16 bit
+        pin ==  2 ? PinInfo{ 0x2E, 4, 0x90,  5, 0x9A,  true  } : // PE4 OC3B
+        pin ==  3 ? PinInfo{ 0x2E, 5, 0x90,  3, 0x9C,  true  } : // PE5 OC3C
+        pin ==  4 ? PinInfo{ 0x34, 5, 0x44,  5, 0x48,  false } : // PG5 OC0B
+        pin ==  5 ? PinInfo{ 0x2E, 3, 0x90,  7, 0x98,  true  } : // PE3 OC3A
+        pin ==  6 ? PinInfo{ 0x102, 3, 0xA0, 7, 0xA8,  true  } : // PH3 OC4A
+        pin ==  7 ? PinInfo{ 0x102, 4, 0xA0, 5, 0xAA,  true  } : // PH4 OC4B
+        pin ==  8 ? PinInfo{ 0x102, 5, 0xA0, 3, 0xAC,  true  } : // PH5 OC4C
+        pin ==  9 ? PinInfo{ 0x102, 6, 0xB0, 5, 0xB4,  false } : // PH6 OC2B
+        pin == 10 ? PinInfo{ 0x25, 4, 0xB0,  7, 0xB3,  false } : // PB4 OC2A
+        pin == 11 ? PinInfo{ 0x25, 5, 0x80,  7, 0x88,  true  } : // PB5 OC1A
+        pin == 12 ? PinInfo{ 0x25, 6, 0x80,  5, 0x8A,  true  } : // PB6 OC1B
+        pin == 13 ? PinInfo{ 0x25, 7, 0x44,  7, 0x47,  false } : // PB7 OC0A
+        pin == 38 ? PinInfo{ 0x2B, 7, 0,     0, 0,     false } : // PD7
+        pin == 39 ? PinInfo{ 0x34, 2, 0,     0, 0,     false } : // PG2
+        pin == 40 ? PinInfo{ 0x34, 1, 0,     0, 0,     false } : // PG1
+        pin == 41 ? PinInfo{ 0x34, 0, 0,     0, 0,     false } : // PG0
+        pin == 42 ? PinInfo{ 0x10B, 7, 0,    0, 0,     false } : // PL7
+        pin == 43 ? PinInfo{ 0x10B, 6, 0,    0, 0,     false } : // PL6
+        pin == 44 ? PinInfo{ 0x10B, 5, 0x120, 3, 0x12C, true } : // PL5 OC5C
+        pin == 45 ? PinInfo{ 0x10B, 4, 0x120, 5, 0x12A, true } : // PL4 OC5B
+        pin == 46 ? PinInfo{ 0x10B, 3, 0x120, 7, 0x128, true } : // PL3 OC5A
+        PinInfo{ 0, 0, 0, 0, 0, false };
+}
+
+#if PF_OUTPUT_DIRECT_IO
+// Set or clear bits of a register, registers above the sbi/cbi range need interrupts locked for read-modify-write.
+template<uint16_t ADDRESS, uint8_t MASK>
+inline void write_bits(bool set) {
+    if (ADDRESS >= 0x40) {
+        uint8_t sreg = SREG;
+        cli();
+        if (set) _SFR_MEM8(ADDRESS) |= MASK; else _SFR_MEM8(ADDRESS) &= ~MASK;
+        SREG = sreg;
+    } else {
+        if (set) _SFR_MEM8(ADDRESS) |= MASK; else _SFR_MEM8(ADDRESS) &= ~MASK;
+    }
+}
+
+// Same semantics as analogWrite(), without pinMode() and the lookup tables.
+template<uint8_t PIN>
+inline void write(uint8_t value) {
+    constexpr PinInfo pin = pin_info(PIN);
+    static_assert(pin.port, "Pin isn't supported by PowerFunctionsOutputT, use PowerFunctionsOutput instead");
+    if (pin.ocr && value != 0 && value != 255) {
+        if (pin.ocr16) _SFR_MEM16(pin.ocr) = value; else _SFR_MEM8(pin.ocr) = value;
+        write_bits<pin.tccr, 1 << pin.com_bit>(true);
+        return;
+    }
+#if PF_OUT_SOFT_PWM
+    if (!pin.ocr) {
+        SoftPWM::write(PIN, value);
+        return;
+    }
+#endif
+    // Full on/off or no timer: disconnect the timer and drive the pin (digital pins switch at 128).
+    if (pin.ocr) write_bits<pin.tccr, 1 << pin.com_bit>(false);
+    write_bits<pin.port, 1 << pin.bit>(value >= 128);
+}
+
+template<uint8_t PIN>
+inline void init( void ) {
+    constexpr PinInfo pin = pin_info(PIN);
+    // DDRx is located right below PORTx.
+    write_bits<pin.port - 1, 1 << pin.bit>(true);
+#if PF_OUT_SOFT_PWM
+    if (!pin.ocr) SoftPWM::attach(PIN);
+#endif
+}
+#else
+template<uint8_t PIN>
+inline void write(uint8_t value) {
+#if PF_OUT_SOFT_PWM
+    if (SoftPWM::write(PIN, value)) return;
+#endif
+    analogWrite(PIN, value);
+}
+
+template<uint8_t PIN>
+inline void init( void ) {
+    pinMode(PIN, OUTPUT);
+#if PF_OUT_SOFT_PWM
+    if (digitalPinToTimer(PIN) == NOT_ON_TIMER) SoftPWM::attach(PIN);
+#endif
+}
+#endif
+
+}; // end namespace
+
+template<uint8_t PIN_C1, uint8_t PIN_C2>
+class PowerFunctionsOutputT
+{
+  public:
+    PowerFunctionsOutputT( void )
+    {
+        PowerFunctionsOutputIO::init<PIN_C1>();
+        PowerFunctionsOutputIO::init<PIN_C2>();
+        off();
+    }
+    ~PowerFunctionsOutputT( void ) { off(); }
+    // setters for c1
+    void c1_set ( uint8_t value ) { PowerFunctionsOutputIO::write<PIN_C1>(value); _value_c1 = value; }
+    void c1_on  ( void ) { c1_set(255); }
+    void c1_off ( void ) { c1_set(0); }
+    // setters for c2
+    void c2_set ( uint8_t value ) { PowerFunctionsOutputIO::write<PIN_C2>(value); _value_c2 = value; }
+    void c2_on  ( void ) { c2_set(255); }
+    void c2_off ( void ) { c2_set(0); }
+    // setters both
+    void set( uint8_t value_c1, uint8_t value_c2 ) { c1_set(value_c1); c2_set(value_c2); }
+    void off( void ) { set(0,0); }
+    // getters for c1
+    uint8_t c1_get( void ) const { return _value_c1; }
+    bool c1_is_off( void ) const { return _value_c1 == 0; }
+    // getters for c2
+    uint8_t c2_get( void ) const { return _value_c2; }
+    bool c2_is_off( void ) const { return _value_c2 == 0; }
+    // getters both
+    bool is_off( void ) const { return c1_is_off() && c2_is_off(); }
+    // pins
+    uint8_t c1_pin( void ) const { return PIN_C1; }
+    uint8_t c2_pin( void ) const { return PIN_C2; }
+  private:
+    uint8_t _value_c1 = 0;
+    uint8_t _value_c2 = 0;
+};
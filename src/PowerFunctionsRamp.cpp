@@ -0,0 +1,68 @@
+#include "PowerFunctionsRamp.h"
+
+PowerFunctionsRamp* PowerFunctionsRamp::_first = 0;
+unsigned long PowerFunctionsRamp::_last_tick = 0;
+bool PowerFunctionsRamp::_ticking = false;
+
+PowerFunctionsRamp::PowerFunctionsRamp(PowerFunctionsOutput &output, uint8_t acceleration)
+{
+    _output = &output;
+    set_acceleration(acceleration);
+    _next = _first;
+    _first = this;
+}
+
+PowerFunctionsRamp::~PowerFunctionsRamp( void )
+{
+    for (PowerFunctionsRamp** ramp = &_first; *ramp; ramp = &(*ramp)->_next) {
+        if (*ramp == this) {
+            *ramp = _next;
+            break;
+        }
+    }
+}
+
+void PowerFunctionsRamp::stop( void )
+{
+    _target = _value = 0;
+    write();
+}
+
+void PowerFunctionsRamp::tick(uint16_t ticks)
+{
+    if (_value == _target) return;
+    // maximum step for all ticks at once, so late ticks still cost O(1)
+    uint32_t step = (uint32_t)_acceleration * ticks;
+    int16_t diff = _target - _value;
+    if (diff > 0) {
+        _value = (uint32_t)diff > step ? _value + (int16_t)step : _target;
+    } else {
+        _value = (uint32_t)-diff > step ? _value - (int16_t)step : _target;
+    }
+    write();
+}
+
+void PowerFunctionsRamp::write( void )
+{
+    if (_value >= 0) {
+        _output->set(_value, 0);
+    } else {
+        _output->set(0, -_value);
+    }
+}
+
+void PowerFunctionsRamp::update( void )
+{
+    // the first call starts the ticks, the time since boot would move all ramps at once
+    if (!_ticking) {
+        _last_tick = millis();
+        _ticking = true;
+        return;
+    }
+    unsigned long ticks = (millis() - _last_tick) / RAMP_TICK_MS;
+    if (!ticks) return;
+    _last_tick += ticks * RAMP_TICK_MS;
+    // a full ramp from -255 to 255 never needs more than 510 ticks
+    if (ticks > 510) ticks = 510;
+    for (PowerFunctionsRamp* ramp = _first; ramp; ramp = ramp->_next) ramp->tick(ticks);
+}
@@ -0,0 +1,45 @@
+/*
+  PowerFunctionsRamp.h - Acceleration limited motion profile between IR values and a PowerFunctionsOutput.
+  Created by Heiko Finzel, 2017.
+
+  Values range from -255 (full backward, c2) to 255 (full forward, c1), just like ChannelState's value().
+  New targets are applied in place, the ramp continues from the current value.
+  All ramps advance in PowerFunctionsRamp::update() (call it in loop()), without blocking and floating point math.
+*/
+#pragma once
+#include "Arduino.h"
+#include "BrixxSettings.h"
+#include "PowerFunctionsOutput.h"
+
+class PowerFunctionsRamp
+{
+  public:
+    // acceleration is the maximum change of value per tick (RAMP_TICK_MS), 255 = no ramp
+    PowerFunctionsRamp( PowerFunctionsOutput &output, uint8_t acceleration );
+    ~PowerFunctionsRamp( void );
+    // setters
+    void set_target( int16_t target ) { _target = constrain(target, -255, 255); }
+    void set_acceleration( uint8_t acceleration ) { _acceleration = acceleration ? acceleration : 1; }
+    // stop immediately, without ramp
+    void stop( void );
+    // getters
+    int16_t get_target( void ) const { return _target; }
+    int16_t get_value( void ) const { return _value; }
+    uint8_t get_acceleration( void ) const { return _acceleration; }
+    bool is_done( void ) const { return _value == _target; }
+    // advance this ramp by ticks and write the output if the value changed
+    void tick( uint16_t ticks = 1 );
+    // advance all ramps by the ticks passed since the last call (the first call starts the ticks), call this in loop()
+    static void update( void );
+  private:
+    PowerFunctionsOutput* _output;
+    int16_t _value = 0;
+    int16_t _target = 0;
+    uint8_t _acceleration;
+    // all ramps, linked on construction
+    PowerFunctionsRamp* _next;
+    static PowerFunctionsRamp* _first;
+    static unsigned long _last_tick;
+    static bool _ticking;
+    void write( void );
+};
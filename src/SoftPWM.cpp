@@ -0,0 +1,219 @@
+/*
+ * SoftPWM.cpp - Software pwm for the digital PF_OUT_D pin pairs
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ * Note: Although this project aims to connect LEGO Power Functions hardware to Arduino without damaging anything else
+ * then just a few extension cables, I'll take no responsibility for any damage done to any of your hardware.
+ * Warranty for your LEGO Power Functions items may void using this project.
+ */
+#include "SoftPWM.h"
+
+namespace SoftPWM {
+
+static_assert(SOFT_PWM_LEVELS >= 2 && SOFT_PWM_LEVELS <= 255, "SOFT_PWM_LEVELS must be between 2 and 255");
+
+/*
+    Schedule struct.
+    Port bits to switch on at the start of a period and edges to switch them off, sorted by tick.
+*/
+struct Schedule {
+    uint8_t on[SOFT_PWM_PORTS];
+    uint8_t edges;
+    struct {
+        uint8_t tick;
+        uint8_t off[SOFT_PWM_PORTS];
+    } edge[SOFT_PWM_PINS];
+};
+
+/*
+    Variables.
+*/
+// Attached pins, their port (index into ports) and bit mask and duty cycle in levels.
+uint8_t pins;
+uint8_t pin_number[SOFT_PWM_PINS];
+uint8_t pin_port[SOFT_PWM_PINS];
+uint8_t pin_mask[SOFT_PWM_PINS];
+uint8_t pin_level[SOFT_PWM_PINS];
+// Output registers of the ports used.
+volatile uint8_t ports;
+volatile uint8_t* port_register[SOFT_PWM_PORTS];
+// Active and inactive schedule, tick() swaps them at the start of a period if requested.
+Schedule schedules[2];
+volatile uint8_t active;
+volatile bool swap_pending;
+// Position in the period and next edge of the active schedule.
+uint8_t level;
+uint8_t next_edge;
+bool timer_running;
+
+// Keep the compiler from moving the schedule stores across the swap_pending stores, tick() reads them concurrently.
+#define SCHEDULE_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/*
+    Timer.
+*/
+#if defined(TIMER2_OVF_vect)
+ISR(TIMER2_OVF_vect) {
+    tick();
+}
+
+// Timer2's pwm outputs (pins 9 and 10), kept as they are, and its mode and prescaler before start_timer().
+#define TIMER2_OUTPUTS (_BV(COM2A1) | _BV(COM2A0) | _BV(COM2B1) | _BV(COM2B0))
+uint8_t saved_tccr2a;
+uint8_t saved_tccr2b;
+
+static void start_timer( void ) {
+    // Started by write(), not by attach(): global outputs attach before the Arduino core's init(), which would set
+    // its own prescaler afterwards. Assign the mode and prescaler completely, only the pwm outputs on pins 9 and 10
+    // are kept: phase correct pwm, prescaler 8, that's 16 MHz / 8 / 510 = 3.9 kHz.
+    uint8_t sreg = SREG;
+    cli();
+    saved_tccr2a = TCCR2A & ~TIMER2_OUTPUTS;
+    saved_tccr2b = TCCR2B;
+    TCCR2A = (TCCR2A & TIMER2_OUTPUTS) | _BV(WGM20);
+    TCCR2B = _BV(CS21);
+    // Start with a full tick, not with an overflow flagged before.
+    TIFR2 = _BV(TOV2);
+    TIMSK2 |= _BV(TOIE2);
+    SREG = sreg;
+}
+
+static void stop_timer( void ) {
+    uint8_t sreg = SREG;
+    cli();
+    TIMSK2 &= ~_BV(TOIE2);
+    TCCR2A = (TCCR2A & TIMER2_OUTPUTS) | saved_tccr2a;
+    TCCR2B = saved_tccr2b;
+    SREG = sreg;
+}
+#else
+// No timer on this platform, tick() has to be called by someone else (e.g. the host simulator).
+static void start_timer( void ) {}
+static void stop_timer( void ) {}
+#endif
+
+void tick( void ) {
+    const Schedule* schedule = &schedules[active];
+    if (level == 0) {
+        if (swap_pending) {
+            active ^= 1;
+            swap_pending = false;
+            schedule = &schedules[active];
+        }
+        for (uint8_t p = 0; p < ports; p++) *port_register[p] |= schedule->on[p];
+        next_edge = 0;
+    }
+    if (next_edge < schedule->edges && schedule->edge[next_edge].tick == level) {
+        for (uint8_t p = 0; p < ports; p++) *port_register[p] &= ~schedule->edge[next_edge].off[p];
+        next_edge++;
+    }
+    if (++level >= SOFT_PWM_LEVELS) level = 0;
+}
+
+/*
+    Schedule building, only called from write().
+*/
+static void build(Schedule &schedule) {
+    // Pin indexes sorted by level (insertion sort, there are only a few pins).
+    uint8_t order[SOFT_PWM_PINS];
+    for (uint8_t i = 0; i < pins; i++) {
+        uint8_t j = i;
+        for (; j > 0 && pin_level[order[j - 1]] > pin_level[i]; j--) order[j] = order[j - 1];
+        order[j] = i;
+    }
+    for (uint8_t p = 0; p < SOFT_PWM_PORTS; p++) schedule.on[p] = 0;
+    schedule.edges = 0;
+    for (uint8_t i = 0; i < pins; i++) {
+        uint8_t pin = order[i];
+        // Level 0 is never switched on, full level is never switched off.
+        if (pin_level[pin] == 0) continue;
+        schedule.on[pin_port[pin]] |= pin_mask[pin];
+        if (pin_level[pin] >= SOFT_PWM_LEVELS) continue;
+        if (!schedule.edges || schedule.edge[schedule.edges - 1].tick != pin_level[pin]) {
+            schedule.edge[schedule.edges].tick = pin_level[pin];
+            for (uint8_t p = 0; p < SOFT_PWM_PORTS; p++) schedule.edge[schedule.edges].off[p] = 0;
+            schedule.edges++;
+        }
+        schedule.edge[schedule.edges - 1].off[pin_port[pin]] |= pin_mask[pin];
+    }
+}
+
+// Switch all pins as schedule does at the start of a period, for pins fully on or off while the timer is stopped.
+static void apply(const Schedule &schedule) {
+    for (uint8_t p = 0; p < ports; p++) {
+        uint8_t mask = 0;
+        for (uint8_t i = 0; i < pins; i++) if (pin_port[i] == p) mask |= pin_mask[i];
+        // Other pins of the port may be written by interrupts.
+        uint8_t sreg = SREG;
+        cli();
+        *port_register[p] = (*port_register[p] & ~mask) | schedule.on[p];
+        SREG = sreg;
+    }
+}
+
+/*
+    User interface functions.
+*/
+static int8_t find(uint8_t pin) {
+    for (uint8_t i = 0; i < pins; i++) if (pin_number[i] == pin) return i;
+    return -1;
+}
+
+bool attached(uint8_t pin) {
+    return find(pin) >= 0;
+}
+
+bool attach(uint8_t pin) {
+    if (attached(pin)) return true;
+    if (pins >= SOFT_PWM_PINS) return false;
+    volatile uint8_t* out = portOutputRegister(digitalPinToPort(pin));
+    uint8_t port = 0;
+    for (; port < ports && port_register[port] != out; port++);
+    if (port >= SOFT_PWM_PORTS) return false;
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+    // The new pin has level 0, so both schedules are still valid for it.
+    if (port == ports) port_register[ports++] = out;
+    pin_number[pins] = pin;
+    pin_port[pins] = port;
+    pin_mask[pins] = digitalPinToBitMask(pin);
+    pin_level[pins] = 0;
+    pins++;
+    return true;
+}
+
+bool write(uint8_t pin, uint8_t value) {
+    int8_t i = find(pin);
+    if (i < 0) return false;
+    uint8_t new_level = ((uint16_t)value * SOFT_PWM_LEVELS + 127) / 255;
+    if (pin_level[i] == new_level) return true;
+    pin_level[i] = new_level;
+    // The timer only runs while a pin has a duty cycle between off and full.
+    bool modulated = false;
+    for (uint8_t p = 0; p < pins; p++) modulated |= pin_level[p] && pin_level[p] < SOFT_PWM_LEVELS;
+    // Hold back a pending swap before choosing the inactive schedule, so tick() can't swap while we build it.
+    swap_pending = false;
+    SCHEDULE_BARRIER();
+    build(schedules[active ^ 1]);
+    SCHEDULE_BARRIER();
+    if (modulated) {
+        swap_pending = true;
+        if (!timer_running) {
+            start_timer();
+            timer_running = true;
+        }
+    } else {
+        // No more ticks, switch the pins at once and start the next period from the beginning.
+        if (timer_running) {
+            stop_timer();
+            timer_running = false;
+        }
+        active ^= 1;
+        level = 0;
+        apply(schedules[active]);
+    }
+    return true;
+}
+
+}; // end namespace
@@ -0,0 +1,38 @@
+/*
+ * SoftPWM.h - Software pwm for the digital PF_OUT_D pin pairs
+ * Copyright© 2017 by Heiko Finzel
+ * The Brixx Library and all other content of this project is distributed under the terms and conditions of the
+ * GNU GENERAL PUBLIC LICENSE Version 3.
+ * Note: Although this project aims to connect LEGO Power Functions hardware to Arduino without damaging anything else
+ * then just a few extension cables, I'll take no responsibility for any damage done to any of your hardware.
+ * Warranty for your LEGO Power Functions items may void using this project.
+ *
+ *   - All software pwm pins share one timer interrupt (timer2 overflow), that calls tick() SOFT_PWM_LEVELS times per
+ *     pwm period.
+ *   - At the start of a period all pins with a duty cycle > 0 are switched on, then pins are switched off in order
+ *     of their duty cycle, following a pre-sorted edge schedule. Pins with the same duty cycle share one edge, so
+ *     every tick does at most one port write per port, regardless of the number of pins.
+ *   - write() rebuilds the schedule (only if the duty cycle changed) into a second buffer, tick() swaps buffers at
+ *     the start of the next period.
+ *   - Timer2 only runs for software pwm while a pin has a duty cycle between off and full, pins fully on or off are
+ *     switched by write() directly. Its prescaler is changed from 64 to 8 by the write() starting it (so after the
+ *     Arduino core's init(), even for global outputs), hardware pwm on pins 9 and 10 keeps working at 3.9 kHz then.
+ *     The write() stopping it restores timer2's mode and prescaler (490 Hz on pins 9 and 10).
+ */
+#pragma once
+#include "Arduino.h"
+#include "BrixxSettings.h"
+
+namespace SoftPWM {
+
+// Register pin for software pwm (output, off), false if SOFT_PWM_PINS/_PORTS are exceeded.
+bool attach(uint8_t pin);
+// Set the duty cycle of an attached pin (0-255, same as analogWrite()) and start or stop the timer, false if pin isn't
+// attached.
+bool write(uint8_t pin, uint8_t value);
+// Check if pin is attached.
+bool attached(uint8_t pin);
+// Timer interrupt routine, advances the pwm by one level (called from timer2 overflow interrupt).
+void tick( void );
+
+}; // end namespace